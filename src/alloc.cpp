@@ -0,0 +1,101 @@
+#include "alloc.hpp"
+#include <algorithm>
+#include <cstdint>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+static byte* align_ptr(byte* ptr, size_t align) {
+    const auto addr = reinterpret_cast<uintptr_t>(ptr);
+    return ptr + ((align - addr % align) % align);
+}
+
+Arena::Arena(size_t block, std::pmr::memory_resource* up): block_size(block), upstream(up) {}
+
+Arena::~Arena() {
+    release();
+}
+
+void Arena::release() {
+    while (blocks != nullptr) {
+        Block* next = blocks->next;
+        upstream->deallocate(blocks, blocks->size, alignof(std::max_align_t));
+        blocks = next;
+    }
+    cursor = nullptr;
+    end = nullptr;
+    counters = {};
+}
+
+void* Arena::do_allocate(size_t bytes, size_t align) {
+    byte* ptr = cursor != nullptr ? align_ptr(cursor, align) : nullptr;
+    if (ptr == nullptr || ptr + bytes > end) {
+        // oversized requests get a block of their own
+        const size_t size = std::max(block_size, sizeof(Block) + bytes + align);
+        auto* block = static_cast<Block*>(upstream->allocate(size, alignof(std::max_align_t)));
+        block->next = blocks;
+        block->size = size;
+        blocks = block;
+        counters.reserved += size;
+        cursor = reinterpret_cast<byte*>(block + 1);
+        end = reinterpret_cast<byte*>(block) + size;
+        ptr = align_ptr(cursor, align);
+    }
+    cursor = ptr + bytes;
+    counters.allocations++;
+    counters.bytes += bytes;
+    return ptr;
+}
+
+Frame_arena::Frame_arena(size_t capacity, std::pmr::memory_resource* up)
+    : buffer_size(capacity), upstream(up) {
+    buffer = static_cast<byte*>(upstream->allocate(buffer_size, alignof(std::max_align_t)));
+    counters.reserved = buffer_size;
+}
+
+Frame_arena::~Frame_arena() {
+    reset();
+    upstream->deallocate(buffer, buffer_size, alignof(std::max_align_t));
+}
+
+void Frame_arena::reset() {
+    for (const auto& overflow : overflows) {
+        upstream->deallocate(overflow.ptr, overflow.bytes, overflow.align);
+    }
+    overflows.clear();
+    offset = 0;
+    previous = counters;
+    counters = {.reserved = buffer_size};
+}
+
+void* Frame_arena::do_allocate(size_t bytes, size_t align) {
+    counters.allocations++;
+    counters.bytes += bytes;
+    byte* ptr = align_ptr(buffer + offset, align);
+    if (ptr + bytes <= buffer + buffer_size) {
+        offset = ptr + bytes - buffer;
+        return ptr;
+    }
+    void* fallback = upstream->allocate(bytes, align);
+    overflows.push_back({fallback, bytes, align});
+    counters.overflows++;
+    counters.reserved += bytes;
+    return fallback;
+}
+
+u64 peak_rss_bytes() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return usage.ru_maxrss;
+#else
+    // kilobytes on Linux and the BSDs
+    return (u64)usage.ru_maxrss * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,99 @@
+#ifndef RGL_ALLOC_HPP
+#define RGL_ALLOC_HPP
+
+#include "types_utils.hpp"
+#include <memory_resource>
+
+// Allocators usable with std::pmr containers (std::pmr::vector<T> v{&arena}).
+// Neither frees individual allocations, memory goes back in one go.
+
+template <typename T>
+using Pmr_vec = std::pmr::vector<T>;
+
+struct Alloc_stats {
+    // allocations served and bytes asked for
+    u64 allocations = 0;
+    u64 bytes = 0;
+    // bytes taken from the upstream resource
+    u64 reserved = 0;
+    // frame arena only: allocations that didn't fit the buffer
+    u64 overflows = 0;
+};
+
+// Monotonic arena for data that dies together (a map generation). Bumps
+// through blocks taken from upstream, deallocate() is a no-op and every
+// block is released at once by release() or the destructor.
+struct Arena : std::pmr::memory_resource {
+    explicit Arena(size_t block_size = 64 * 1024,
+            std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void release();
+    const Alloc_stats& stats() const { return counters; }
+
+private:
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+
+    const size_t block_size;
+    std::pmr::memory_resource* const upstream;
+    Block* blocks = nullptr;
+    byte*  cursor = nullptr;
+    byte*  end = nullptr;
+    Alloc_stats counters;
+
+    void* do_allocate(size_t bytes, size_t align) override;
+    void  do_deallocate(void*, size_t, size_t) override {}
+    bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// Scratch memory for a single frame: a fixed buffer bumped by every
+// allocation and rewound by reset() at the top of the frame. Allocations
+// that don't fit go to upstream and are freed on the next reset().
+struct Frame_arena : std::pmr::memory_resource {
+    explicit Frame_arena(size_t capacity,
+            std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~Frame_arena();
+
+    Frame_arena(const Frame_arena&) = delete;
+    Frame_arena& operator=(const Frame_arena&) = delete;
+
+    void reset();
+    // usage of the frame being built and of the last completed one
+    const Alloc_stats& stats() const { return counters; }
+    const Alloc_stats& last_frame() const { return previous; }
+    size_t capacity() const { return buffer_size; }
+
+private:
+    struct Overflow {
+        void*  ptr;
+        size_t bytes;
+        size_t align;
+    };
+
+    const size_t buffer_size;
+    std::pmr::memory_resource* const upstream;
+    byte*  buffer;
+    size_t offset = 0;
+    Vec<Overflow> overflows;
+    Alloc_stats counters;
+    Alloc_stats previous;
+
+    void* do_allocate(size_t bytes, size_t align) override;
+    void  do_deallocate(void*, size_t, size_t) override {}
+    bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// high water mark of the process' resident memory, 0 where unsupported
+u64 peak_rss_bytes();
+
+#endif // RGL_ALLOC_HPP
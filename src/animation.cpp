@@ -0,0 +1,43 @@
+#include "animation.hpp"
+
+// shortest frame, also keeps advance_animations() from dividing by zero
+constexpr float min_frame_ms = 1.f;
+
+Clip_id Animations::add_clip(Anim_clip clip) {
+    if (clip.count == 0) {
+        clip.count = 1;
+    }
+    // negated so NaN is clamped too
+    if (!(clip.frame_ms >= min_frame_ms)) {
+        clip.frame_ms = min_frame_ms;
+    }
+    clips.push_back(clip);
+    return clips.size() - 1;
+}
+
+void Animations::play(ID id, Clip_id clip) {
+    auto* anim = comps.find(id);
+    if (anim == nullptr) {
+        comps.add(id, Animation{.clip = clip});
+    } else if (anim->clip != clip) {
+        *anim = Animation{.clip = clip};
+    }
+}
+
+u32 Animations::sprite_of(const Animation& anim) const {
+    return clips[anim.clip].first + anim.frame;
+}
+
+void advance_animations(Animations& anims, float delta_ms) {
+    const Anim_clip* clips = anims.clips.data();
+    for (auto& anim : anims.comps.dense) {
+        const auto& clip = clips[anim.clip];
+        anim.elapsed_ms += delta_ms;
+        if (anim.elapsed_ms >= clip.frame_ms) {
+            // long frames may skip several animation frames at once
+            const u32 steps = anim.elapsed_ms / clip.frame_ms;
+            anim.elapsed_ms -= steps * clip.frame_ms;
+            anim.frame = (anim.frame + steps) % clip.count;
+        }
+    }
+}
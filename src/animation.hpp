@@ -0,0 +1,37 @@
+#ifndef RGL_ANIMATION_HPP
+#define RGL_ANIMATION_HPP
+
+#include "types_utils.hpp"
+#include "component_pool.hpp"
+
+using Clip_id = u16;
+
+// a run of consecutive frames in a Renderable's sprite list
+struct Anim_clip {
+    u16   first = 0;
+    u16   count = 1;
+    float frame_ms = 100.f;
+};
+
+struct Animation {
+    Clip_id clip = 0;
+    u16     frame = 0;
+    float   elapsed_ms = 0.f;
+};
+
+struct Animations {
+    Vec<Anim_clip> clips;
+    Component_pool<Animation> comps;
+
+    // an empty clip gets one frame, frames shorter than 1 ms are clamped
+    Clip_id add_clip(Anim_clip clip);
+    // restarts the animation only when the clip changes
+    void play(ID id, Clip_id clip);
+    // index into Renderable::sprites
+    u32 sprite_of(const Animation& anim) const;
+};
+
+// advances every animation by the frame delta
+void advance_animations(Animations& anims, float delta_ms);
+
+#endif // RGL_ANIMATION_HPP
@@ -0,0 +1,89 @@
+#ifndef RGL_BENCH_HPP
+#define RGL_BENCH_HPP
+
+#include "../types_utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fmt/format.h>
+
+// Shared helpers for the benchmark executables: timing, sample statistics
+// and a minimal JSON writer so results can be diffed between commits.
+
+inline u64 bench_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// keeps the optimiser from dropping a computed value
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Bench_stats {
+    u64    samples = 0;
+    double mean    = 0.0;
+    double median  = 0.0;
+    double p95     = 0.0;
+    double min     = 0.0;
+    double max     = 0.0;
+    double stddev  = 0.0;
+};
+
+// sorts samples in place
+inline Bench_stats calc_stats(Vec<double>& samples) {
+    Bench_stats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    stats.samples = samples.size();
+    double sum = 0.0;
+    for (const auto& sample : samples) {
+        sum += sample;
+    }
+    stats.mean   = sum / samples.size();
+    stats.median = samples[samples.size() / 2];
+    stats.p95    = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+    stats.min    = samples.front();
+    stats.max    = samples.back();
+    double var = 0.0;
+    for (const auto& sample : samples) {
+        var += (sample - stats.mean) * (sample - stats.mean);
+    }
+    stats.stddev = std::sqrt(var / samples.size());
+    return stats;
+}
+
+using Json_buffer = fmt::memory_buffer;
+
+inline void json_stats(Json_buffer& out, const Bench_stats& stats) {
+    fmt::format_to(std::back_inserter(out),
+        "{{\"samples\":{},\"mean_ns\":{:.1f},\"median_ns\":{:.1f},\"p95_ns\":{:.1f},"
+        "\"min_ns\":{:.1f},\"max_ns\":{:.1f},\"stddev_ns\":{:.1f}}}",
+        stats.samples, stats.mean, stats.median, stats.p95,
+        stats.min, stats.max, stats.stddev);
+}
+
+// returns the value following `name` on the command line or `fallback`
+inline const char* bench_arg(int argc, char* argv[], const char* name, const char* fallback) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return argv[i + 1];
+        }
+    }
+    return fallback;
+}
+
+inline bool bench_flag(int argc, char* argv[], const char* name) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // RGL_BENCH_HPP
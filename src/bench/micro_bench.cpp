@@ -0,0 +1,245 @@
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "bench.hpp"
+#include "../map.hpp"
+#include "../map_impl.hpp"
+#include "../alloc.hpp"
+#include "../particles.hpp"
+#include "../physics.hpp"
+
+// Microbenchmarks for the simulation and generation hot paths, no window
+// or renderer involved. Every case runs `warmup` untimed repetitions and
+// `reps` timed ones; a sample is the mean ns per operation of one
+// repetition, so the stats describe the spread between repetitions.
+// Whole generation is slow enough (seconds at 64x48) to get its own, lower
+// repetition counts.
+// Usage: micro_bench [--reps N] [--warmup N] [--gen-reps N] [--gen-warmup N]
+//                    [--quick] [--output file.json]
+
+constexpr u32 lookups_per_rep = 100'000;
+constexpr u32 cells_per_rep   = 1'000;
+// one frame at the display rate
+constexpr float particle_step_ms = 1'000.f / 240;
+
+struct Micro_case {
+    Json_buffer& out;
+    u32 warmup;
+    u32 reps;
+    bool first = true;
+
+    // `body` performs `items` operations per call
+    template <typename F>
+    void run(const char* name, const std::string& params, u64 items, F&& body) {
+        run(name, params, items, [] {}, body);
+    }
+
+    // `setup` runs untimed before every repetition
+    template <typename S, typename F>
+    void run(const char* name, const std::string& params, u64 items, S&& setup, F&& body) {
+        Vec<double> samples;
+        samples.reserve(reps);
+        for (u32 i = 0; i < warmup + reps; i++) {
+            setup();
+            const u64 begin = bench_now_ns();
+            body();
+            const u64 elapsed = bench_now_ns() - begin;
+            if (i >= warmup) {
+                samples.push_back((double)elapsed / items);
+            }
+        }
+        const auto stats = calc_stats(samples);
+        auto json = std::back_inserter(out);
+        fmt::format_to(json, "{}{{\"name\":\"{}\",\"params\":{{{}}},\"items\":{},\"ns_per_op\":",
+                first ? "" : ",", name, params, items);
+        json_stats(out, stats);
+        fmt::format_to(json, ",\"items_per_sec\":{:.0f}}}",
+                stats.median > 0.0 ? 1e9 / stats.median : 0.0);
+        first = false;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    const bool quick   = bench_flag(argc, argv, "--quick");
+    const u32 reps     = std::atoi(bench_arg(argc, argv, "--reps", quick ? "10" : "50"));
+    const u32 warmup   = std::atoi(bench_arg(argc, argv, "--warmup", quick ? "2" : "5"));
+    const u32 gen_reps   = std::atoi(bench_arg(argc, argv, "--gen-reps", quick ? "2" : "5"));
+    const u32 gen_warmup = std::atoi(bench_arg(argc, argv, "--gen-warmup", quick ? "0" : "1"));
+    const char* output = bench_arg(argc, argv, "--output", nullptr);
+
+    const Vec<Vec2u> map_sizes = quick
+        ? Vec<Vec2u>{{32, 24}}
+        : Vec<Vec2u>{{16, 16}, {32, 24}, {64, 48}};
+    const Vec<u32> seeds = quick ? Vec<u32>{1} : Vec<u32>{1, 2, 3};
+    const Vec<u32> comp_counts = quick
+        ? Vec<u32>{1'000}
+        : Vec<u32>{1, 100, 10'000};
+    const Vec<u32> particle_counts = quick
+        ? Vec<u32>{100'000}
+        : Vec<u32>{1'000, 10'000, 100'000};
+
+    Json_buffer out;
+    auto json = std::back_inserter(out);
+    fmt::format_to(json, "{{\"benchmark\":\"micro\",\"reps\":{},\"warmup\":{},"
+            "\"gen_reps\":{},\"gen_warmup\":{},\"cases\":[", reps, warmup, gen_reps, gen_warmup);
+    Micro_case bench {out, warmup, reps};
+
+    // lookups on a fixed map, positions drawn up front so the rng isn't timed
+    const Vec2u lookup_dim = {32, 24};
+    Map lookup_map(lookup_dim, Vec2u{16, 12}, false, 1);
+    std::minstd_rand rng(1);
+    Vec<Vec2u> tiles(lookups_per_rep);
+    Vec<Position> positions(lookups_per_rep);
+    for (u32 i = 0; i < lookups_per_rep; i++) {
+        tiles[i] = Vec2u{(u16)(rng() % lookup_dim.x), (u16)(rng() % lookup_dim.y)};
+        positions[i] = Position{
+            (float)(rng() % 10'000) / 10'000.f * Position::MAX,
+            (float)(rng() % 10'000) / 10'000.f * Position::MAX,
+        };
+    }
+    const auto lookup_params = fmt::format("\"map\":[{},{}]", lookup_dim.x, lookup_dim.y);
+    bench.run("map_at", lookup_params, lookups_per_rep, [&] {
+        u32 walls = 0;
+        for (const auto& tile : tiles) {
+            walls += lookup_map.at(tile) == Tile::Wall;
+        }
+        do_not_optimize(walls);
+    });
+    bench.run("map_at_pos", lookup_params, lookups_per_rep, [&] {
+        u32 walls = 0;
+        for (const auto& pos : positions) {
+            walls += lookup_map.at_pos(pos) == Tile::Wall;
+        }
+        do_not_optimize(walls);
+    });
+    bench.run("check_collision", lookup_params, lookups_per_rep, [&] {
+        u32 hits = 0;
+        for (const auto& pos : positions) {
+            hits += check_collision(lookup_map, pos) == COLLISION;
+        }
+        do_not_optimize(hits);
+    });
+
+    // physics, every component restarts from the same state each repetition
+    for (const auto count : comp_counts) {
+        Vec<Physics> initial(count);
+        for (u32 i = 0; i < count; i++) {
+            initial[i].pos = positions[i % positions.size()];
+            initial[i].dir = (Direction)(i % 3);
+            initial[i].loc = (Location)(i % 2);
+        }
+        Vec<Physics> comps;
+        bench.run("update_tick", fmt::format("\"components\":{}", count), count, [&] {
+            comps = initial;
+            for (auto& comp : comps) {
+                update_tick(comp, lookup_map);
+            }
+            do_not_optimize(comps.data());
+        });
+    }
+
+    // particles refilled before every repetition, with bursts spread over
+    // the map so they hit walls and floors like in game
+    for (const auto count : particle_counts) {
+        Particle_system particles(count);
+        particles.set_map(lookup_map);
+        auto refill = [&] {
+            particles.clear();
+            for (u32 i = 0; particles.size() < count; i++) {
+                const auto& pos = positions[i % positions.size()];
+                particles.spawn(Particle_burst {
+                    .pos = pos,
+                    .count = 64,
+                    .kind = (Particle_kind)(i % PARTICLE_KIND_MAX),
+                });
+            }
+        };
+        const auto particle_params = fmt::format("\"particles\":{},\"map\":[{},{}]",
+                count, lookup_dim.x, lookup_dim.y);
+        bench.run("particles_update", particle_params, count, refill, [&] {
+            particles.update(particle_step_ms);
+            do_not_optimize(particles.size());
+        });
+        refill();
+        bench.run("particles_geometry", particle_params, count, [&] {
+            particles.build_geometry(800, 600);
+            do_not_optimize(particles.vertex_xy.data());
+        });
+    }
+
+    // WFC cell updates: interior cells of a generated map are re-opened and
+    // their weights and entropy recomputed against the collapsed surroundings
+    for (const auto dim : map_sizes) {
+        Map generated(dim, Vec2u{dim.x / 2, dim.y / 2}, false, 1);
+        Map_impl solver(dim, generated.tiles);
+        Vec<Vec2u> cells(cells_per_rep);
+        for (auto& cell : cells) {
+            cell = Vec2u{(u16)(1 + rng() % (dim.x - 2)), (u16)(1 + rng() % (dim.y - 2))};
+        }
+        const auto cell_params = fmt::format("\"map\":[{},{}]", dim.x, dim.y);
+        Vec<N_kernel> kernels(cells.size());
+        for (size_t i = 0; i < cells.size(); i++) {
+            kernels[i] = solver.get_neighbour_kernel(cells[i]);
+        }
+        solver.clear_tainted();
+        bench.run("calc_weights", cell_params, cells.size(), [&] {
+            u32 total = 0;
+            for (size_t i = 0; i < cells.size(); i++) {
+                Tile_entry entry;
+                solver.calc_weights(entry, kernels[i]);
+                total += entry.total_weight;
+            }
+            do_not_optimize(total);
+        });
+        bench.run("calc_cell_info", cell_params, cells.size(), [&] {
+            for (const auto& cell : cells) {
+                solver.cells[solver.get_idx_vec2u(cell)] = Tile_entry{};
+            }
+            for (const auto& cell : cells) {
+                solver.calc_cell_info(cell);
+            }
+            // collapsed again for the next repetition
+            for (const auto& cell : cells) {
+                const u32 idx = solver.get_idx_vec2u(cell);
+                solver.cells[idx] = Tile_entry{.tile = generated.tiles[idx]};
+            }
+            solver.clear_tainted();
+            do_not_optimize(solver.cells.data());
+        });
+    }
+
+    // whole generation, one map per repetition; the solver's arena usage is
+    // the same every repetition so it's measured once, outside the timing
+    bench.reps = gen_reps;
+    bench.warmup = gen_warmup;
+    for (const auto dim : map_sizes) {
+        for (const auto seed : seeds) {
+            Alloc_stats arena;
+            {
+                Map_impl solver(dim, Vec2u{dim.x / 2, dim.y / 2}, seed);
+                arena = solver.arena.stats();
+            }
+            bench.run("generate", fmt::format("\"map\":[{},{}],\"seed\":{},"
+                    "\"arena_allocations\":{},\"arena_reserved\":{}",
+                    dim.x, dim.y, seed, arena.allocations, arena.reserved),
+                    (u64)dim.x * dim.y, [&] {
+                Map map(dim, Vec2u{dim.x / 2, dim.y / 2}, false, seed);
+                do_not_optimize(map.tiles.data());
+            });
+        }
+    }
+    fmt::format_to(json, "],\"peak_rss_kib\":{}}}\n", peak_rss_bytes() / 1024);
+
+    std::FILE* file = output != nullptr ? std::fopen(output, "w") : stdout;
+    if (file == nullptr) {
+        LOG_ERR("Failed to open {}", output);
+        return EXIT_FAILURE;
+    }
+    std::fwrite(out.data(), 1, out.size(), file);
+    if (file != stdout) {
+        std::fclose(file);
+    }
+    return EXIT_SUCCESS;
+}
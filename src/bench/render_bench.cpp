@@ -0,0 +1,203 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_render.h>
+#include <SDL2/SDL_surface.h>
+
+#include "bench.hpp"
+#include "../map.hpp"
+#include "../renderable.hpp"
+
+// Headless render benchmark.
+// Renders scripted scenes with SDL's software renderer into an offscreen
+// surface (dummy video driver) so it runs on machines without a display.
+// 128x96 maps take about a minute of generation each, so they only run
+// with --large.
+// Usage: render_bench [--frames N] [--warmup N] [--quick] [--large]
+//                     [--output file.json]
+
+constexpr u32 screen_w = 800;
+constexpr u32 screen_h = 600;
+constexpr u32 bake_repetitions = 20;
+
+struct Scene {
+    u32   sprites;
+    float flip_ratio;
+};
+
+static SDL_Texture* solid_texture(SDL_Renderer* rndr, int w, int h, byte r, byte g, byte b) {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (surface == nullptr) {
+        return nullptr;
+    }
+    SDL_FillRect(surface, nullptr, SDL_MapRGB(surface->format, r, g, b));
+    // a darker stripe so flipped sprites actually differ
+    SDL_Rect stripe = {0, 0, w / 4, h};
+    SDL_FillRect(surface, &stripe, SDL_MapRGB(surface->format, r / 2, g / 2, b / 2));
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(rndr, surface);
+    SDL_FreeSurface(surface);
+    return texture;
+}
+
+int main(int argc, char* argv[]) {
+    const bool quick   = bench_flag(argc, argv, "--quick");
+    const bool large   = bench_flag(argc, argv, "--large");
+    const u32 frames   = std::atoi(bench_arg(argc, argv, "--frames", quick ? "30" : "300"));
+    const u32 warmup   = std::atoi(bench_arg(argc, argv, "--warmup", quick ? "5" : "30"));
+    const char* output = bench_arg(argc, argv, "--output", nullptr);
+
+    Vec<Vec2u> map_sizes = quick
+        ? Vec<Vec2u>{{32, 24}}
+        : Vec<Vec2u>{{32, 24}, {64, 48}};
+    if (large) {
+        map_sizes.push_back({128, 96});
+    }
+    const Vec<u32> sprite_counts = quick
+        ? Vec<u32>{1, 1'000}
+        : Vec<u32>{1, 100, 1'000, 10'000};
+    const Vec<float> flip_ratios = {0.f, 0.5f, 1.f};
+
+    // environment variable still wins over the hint
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        LOG_ERR("SDL_Init failed: {}, continuing offscreen", SDL_GetError());
+    }
+    defer { SDL_Quit(); };
+
+    SDL_Surface* screen = SDL_CreateRGBSurfaceWithFormat(0, screen_w, screen_h, 32,
+            SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer* rndr = screen != nullptr ? SDL_CreateSoftwareRenderer(screen) : nullptr;
+    if (rndr == nullptr) {
+        LOG_ERR("Failed to create the software renderer: {}", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+    defer {
+        SDL_DestroyRenderer(rndr);
+        SDL_FreeSurface(screen);
+    };
+
+    SDL_Texture* wall_tex    = solid_texture(rndr, 32, 32, 160, 60, 40);
+    SDL_Texture* bg_tex      = solid_texture(rndr, 32, 32, 40, 40, 60);
+    SDL_Texture* sprite0_tex = solid_texture(rndr, 24, 36, 220, 200, 80);
+    SDL_Texture* sprite1_tex = solid_texture(rndr, 24, 36, 200, 220, 80);
+    SDL_Texture* map_texture = SDL_CreateTexture(rndr, SDL_PIXELFORMAT_RGBA8888,
+            SDL_TEXTUREACCESS_TARGET, screen_w, screen_h);
+    defer {
+        SDL_DestroyTexture(wall_tex);
+        SDL_DestroyTexture(bg_tex);
+        SDL_DestroyTexture(sprite0_tex);
+        SDL_DestroyTexture(sprite1_tex);
+        SDL_DestroyTexture(map_texture);
+    };
+    if (wall_tex == nullptr || bg_tex == nullptr || sprite0_tex == nullptr
+            || sprite1_tex == nullptr || map_texture == nullptr) {
+        LOG_ERR("Failed to create textures: {}", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    Renderable sprite_rend {
+        .bnd = {.x = 24, .y = 36},
+        .sprites = {sprite0_tex, sprite1_tex},
+    };
+    // the textures are destroyed above, not by the Renderable
+    defer { sprite_rend.sprites.clear(); };
+
+    Json_buffer out;
+    auto json = std::back_inserter(out);
+    fmt::format_to(json, "{{\"benchmark\":\"render\",\"renderer\":\"software\","
+            "\"screen\":[{},{}],\"frames\":{},\"warmup\":{},\"maps\":[",
+            screen_w, screen_h, frames, warmup);
+
+    Vec<double> bake_samples, blit_samples, entity_samples, present_samples, frame_samples;
+    for (size_t m = 0; m < map_sizes.size(); m++) {
+        const auto dim = map_sizes[m];
+        Map map(dim, Vec2u{dim.x / 2, dim.y / 2});
+
+        bake_samples.clear();
+        for (u32 i = 0; i < bake_repetitions; i++) {
+            const u64 begin = bench_now_ns();
+            bake_map_texture(rndr, map_texture, map, wall_tex, bg_tex, screen_w, screen_h);
+            bake_samples.push_back(bench_now_ns() - begin);
+        }
+        fmt::format_to(json, "{}{{\"map\":[{},{}],\"bake_map\":",
+                m == 0 ? "" : ",", dim.x, dim.y);
+        json_stats(out, calc_stats(bake_samples));
+        fmt::format_to(json, ",\"scenes\":[");
+
+        bool first_scene = true;
+        for (const auto sprite_count : sprite_counts) {
+            for (const auto flip_ratio : flip_ratios) {
+                const Scene scene {sprite_count, flip_ratio};
+                fmt::print(stderr, "map {}x{}, {} sprites, flip ratio {}\n",
+                        dim.x, dim.y, scene.sprites, scene.flip_ratio);
+
+                Vec<Sprite_instance> sprites(scene.sprites);
+                u32 seed = 12345;
+                const u32 flipped = scene.sprites * scene.flip_ratio;
+                for (u32 i = 0; i < scene.sprites; i++) {
+                    auto& sprite = sprites[i];
+                    sprite.id = i;
+                    seed = seed * 1103515245 + 12345;
+                    sprite.pos.x = (seed >> 8) % (u32)Position::MAX;
+                    seed = seed * 1103515245 + 12345;
+                    sprite.pos.y = (seed >> 8) % (u32)Position::MAX;
+                    sprite.dir = i < flipped ? Direction::left : Direction::right;
+                }
+
+                blit_samples.clear();
+                entity_samples.clear();
+                present_samples.clear();
+                frame_samples.clear();
+                for (u32 frame = 0; frame < warmup + frames; frame++) {
+                    const u64 t0 = bench_now_ns();
+                    SDL_RenderClear(rndr);
+                    SDL_RenderCopy(rndr, map_texture, nullptr, nullptr);
+                    const u64 t1 = bench_now_ns();
+                    for (auto& sprite : sprites) {
+                        sprite.frame = frame;
+                        draw_renderable(rndr, sprite_rend, sprite, screen_w, screen_h);
+                    }
+                    const u64 t2 = bench_now_ns();
+                    SDL_RenderPresent(rndr);
+                    const u64 t3 = bench_now_ns();
+                    if (frame < warmup) {
+                        continue;
+                    }
+                    blit_samples.push_back(t1 - t0);
+                    entity_samples.push_back(t2 - t1);
+                    present_samples.push_back(t3 - t2);
+                    frame_samples.push_back(t3 - t0);
+                }
+
+                const auto frame_stats = calc_stats(frame_samples);
+                fmt::format_to(json, "{}{{\"sprites\":{},\"flip_ratio\":{},\"fps\":{:.1f},\"stages\":{{",
+                        first_scene ? "" : ",", scene.sprites, scene.flip_ratio,
+                        frame_stats.mean > 0.0 ? 1e9 / frame_stats.mean : 0.0);
+                fmt::format_to(json, "\"map_blit\":");
+                json_stats(out, calc_stats(blit_samples));
+                fmt::format_to(json, ",\"entities\":");
+                json_stats(out, calc_stats(entity_samples));
+                fmt::format_to(json, ",\"present\":");
+                json_stats(out, calc_stats(present_samples));
+                fmt::format_to(json, ",\"frame\":");
+                json_stats(out, frame_stats);
+                fmt::format_to(json, "}}}}");
+                first_scene = false;
+            }
+        }
+        fmt::format_to(json, "]}}");
+    }
+    fmt::format_to(json, "]}}\n");
+
+    std::FILE* file = output != nullptr ? std::fopen(output, "w") : stdout;
+    if (file == nullptr) {
+        LOG_ERR("Failed to open {}", output);
+        return EXIT_FAILURE;
+    }
+    std::fwrite(out.data(), 1, out.size(), file);
+    if (file != stdout) {
+        std::fclose(file);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+#ifndef RGL_COMPONENT_POOL_HPP
+#define RGL_COMPONENT_POOL_HPP
+
+#include "types_utils.hpp"
+#include "entity.hpp"
+#include <unordered_map>
+
+// Packed component storage: components sit contiguously in `dense` so
+// systems can run over all of them in one loop, `index` maps an entity to
+// its slot. Removal swaps the last component into the hole.
+template <typename T>
+struct Component_pool {
+    Vec<T>  dense;
+    Vec<ID> ids;
+    std::unordered_map<ID, u32> index;
+
+    T& add(ID id, const T& comp) {
+        auto found = index.find(id);
+        if (found != index.end()) {
+            dense[found->second] = comp;
+            return dense[found->second];
+        }
+        index[id] = dense.size();
+        ids.push_back(id);
+        dense.push_back(comp);
+        return dense.back();
+    }
+
+    void remove(ID id) {
+        auto found = index.find(id);
+        if (found == index.end()) {
+            return;
+        }
+        const u32 idx = found->second;
+        const u32 last = dense.size() - 1;
+        if (idx != last) {
+            dense[idx] = std::move(dense[last]);
+            ids[idx] = ids[last];
+            index[ids[idx]] = idx;
+        }
+        dense.pop_back();
+        ids.pop_back();
+        index.erase(found);
+    }
+
+    T* find(ID id) {
+        auto found = index.find(id);
+        return found != index.end() ? &dense[found->second] : nullptr;
+    }
+
+    const T* find(ID id) const {
+        auto found = index.find(id);
+        return found != index.end() ? &dense[found->second] : nullptr;
+    }
+
+    T& at(ID id) {
+        return dense[index.at(id)];
+    }
+
+    size_t size() const {
+        return dense.size();
+    }
+
+    // replaces every component, `ids` and `comps` hold `count` items each
+    void assign(const ID* new_ids, const T* comps, size_t count) {
+        dense.assign(comps, comps + count);
+        ids.assign(new_ids, new_ids + count);
+        index.clear();
+        for (size_t i = 0; i < count; i++) {
+            index[ids[i]] = i;
+        }
+    }
+
+    void clear() {
+        dense.clear();
+        ids.clear();
+        index.clear();
+    }
+};
+
+#endif // RGL_COMPONENT_POOL_HPP
@@ -0,0 +1,106 @@
+#include "compress.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstring>
+
+constexpr u32 HASH_BITS = 12;
+
+static u32 hash3(const byte* p) {
+    const uint32_t v = p[0] | p[1] << 8 | p[2] << 16;
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void put_literals(Vec<byte>& out, const byte* data, size_t count) {
+    while (count > 0) {
+        const size_t run = std::min<size_t>(count, LZ_MAX_LITERALS);
+        out.push_back(run - 1);
+        out.insert(out.end(), data, data + run);
+        data += run;
+        count -= run;
+    }
+}
+
+Vec<byte> lz_compress(const byte* data, size_t size) {
+    PROFILE_ZONE("lz_compress");
+    Vec<byte> out;
+    out.reserve(size / 4 + 16);
+    for (u32 i = 0; i < 4; i++) {
+        out.push_back((uint32_t)size >> (8 * i));
+    }
+    // last position each 3 byte sequence was seen at, offset by one so
+    // zero means empty
+    Vec<uint32_t> last_seen(1u << HASH_BITS, 0);
+
+    size_t literal_start = 0;
+    size_t pos = 0;
+    while (pos + LZ_MIN_MATCH <= size) {
+        const u32 h = hash3(data + pos);
+        const size_t candidate = last_seen[h];
+        last_seen[h] = pos + 1;
+        if (candidate == 0 || pos - (candidate - 1) > LZ_MAX_DISTANCE
+                || memcmp(data + candidate - 1, data + pos, LZ_MIN_MATCH) != 0) {
+            pos++;
+            continue;
+        }
+        const size_t match = candidate - 1;
+        size_t len = LZ_MIN_MATCH;
+        while (pos + len < size && len < LZ_MAX_MATCH && data[match + len] == data[pos + len]) {
+            len++;
+        }
+        put_literals(out, data + literal_start, pos - literal_start);
+        const size_t distance = pos - match;
+        out.push_back(0x80 + (len - LZ_MIN_MATCH));
+        out.push_back(distance & 0xFF);
+        out.push_back(distance >> 8);
+        // keep the table warm for the bytes the match skipped
+        for (size_t i = pos + 1; i < pos + len && i + LZ_MIN_MATCH <= size; i++) {
+            last_seen[hash3(data + i)] = i + 1;
+        }
+        pos += len;
+        literal_start = pos;
+    }
+    put_literals(out, data + literal_start, size - literal_start);
+    return out;
+}
+
+bool lz_decompress(const byte* data, size_t size, Vec<byte>& out) {
+    PROFILE_ZONE("lz_decompress");
+    if (size < 4) {
+        return false;
+    }
+    size_t raw_size = 0;
+    for (u32 i = 0; i < 4; i++) {
+        raw_size |= (size_t)data[i] << (8 * i);
+    }
+    out.clear();
+    out.reserve(raw_size);
+
+    size_t pos = 4;
+    while (pos < size) {
+        const byte token = data[pos++];
+        if (token < 0x80) {
+            const size_t run = token + 1;
+            if (pos + run > size || out.size() + run > raw_size) {
+                return false;
+            }
+            out.insert(out.end(), data + pos, data + pos + run);
+            pos += run;
+            continue;
+        }
+        if (pos + 2 > size) {
+            return false;
+        }
+        const size_t len = token - 0x80 + LZ_MIN_MATCH;
+        const size_t distance = data[pos] | data[pos + 1] << 8;
+        pos += 2;
+        if (distance == 0 || distance > out.size() || out.size() + len > raw_size) {
+            return false;
+        }
+        // byte by byte, the source may overlap what's being written
+        size_t from = out.size() - distance;
+        for (size_t i = 0; i < len; i++) {
+            out.push_back(out[from + i]);
+        }
+    }
+    return out.size() == raw_size;
+}
@@ -0,0 +1,22 @@
+#ifndef RGL_COMPRESS_HPP
+#define RGL_COMPRESS_HPP
+
+#include "types_utils.hpp"
+
+// Byte oriented LZ77 for tile grids and component arrays. A match may
+// overlap its own output, so a long run of one tile costs a few bytes the
+// same way RLE would, repeated rows and patterns are caught as well.
+//
+// Layout: raw size (u32, little endian) followed by tokens. A token byte
+// below 0x80 is a literal run of (token + 1) bytes, otherwise it's a match
+// of (token - 0x80 + LZ_MIN_MATCH) bytes at a u16 little endian distance.
+constexpr u32 LZ_MIN_MATCH = 3;
+constexpr u32 LZ_MAX_MATCH = 0x7F + LZ_MIN_MATCH;
+constexpr u32 LZ_MAX_LITERALS = 0x80;
+constexpr u32 LZ_MAX_DISTANCE = UINT16_MAX;
+
+Vec<byte> lz_compress(const byte* data, size_t size);
+// returns false if `data` is malformed, `out` is left in an unspecified state
+bool lz_decompress(const byte* data, size_t size, Vec<byte>& out);
+
+#endif // RGL_COMPRESS_HPP
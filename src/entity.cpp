@@ -9,3 +9,9 @@ Entity create_new_entity(FLAGS flags) {
     entity.flags = flags;
     return entity;
 }
+
+void reserve_entity_ids(ID id) {
+    if (id > last_id) {
+        last_id = id;
+    }
+}
@@ -16,6 +16,8 @@ struct Entity {
 };
 
 Entity create_new_entity(FLAGS flags);
+// makes sure new ids come after `id`, for entities restored from a save
+void reserve_entity_ids(ID id);
 
 #endif // RGL_ENTITY_HPP
 
@@ -0,0 +1,239 @@
+#include "flow_field.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+static bool is_walkable(Tile tile) {
+    return tile == Tile::Empty || tile == Tile::Stairs;
+}
+
+Flow_field::Flow_field(const Map& map): width(map.width), height(map.height) {
+    const u32 cells = (u32)width * height;
+    dist.assign(cells, UNREACHABLE);
+    dirs.assign(cells, FLOW_NONE);
+    walkable.resize(cells);
+    for (u16 y = 0; y < height; y++) {
+        for (u16 x = 0; x < width; x++) {
+            walkable[x + width * y] = is_walkable(map.at(Vec2u{x, y}));
+        }
+    }
+}
+
+template <typename F>
+void Flow_field::for_neighbours(u32 idx, F&& f) const {
+    const u32 x = idx % width;
+    const u32 y = idx / width;
+    if (y > 0)              f(idx - width);
+    if (y + 1 < height)     f(idx + width);
+    if (x > 0)              f(idx - 1);
+    if (x + 1 < width)      f(idx + 1);
+}
+
+bool Flow_field::is_source(u32 idx) const {
+    return std::find(sources.begin(), sources.end(), idx) != sources.end();
+}
+
+void Flow_field::set_target(Vec2u tile) {
+    set_sources({tile});
+}
+
+void Flow_field::set_sources(const Vec<Vec2u>& tiles) {
+    PROFILE_ZONE("flow_field_update");
+    Vec<u32> next;
+    next.reserve(tiles.size());
+    for (const auto& tile : tiles) {
+        if (tile.x < width && tile.y < height) {
+            next.push_back(tile.x + width * tile.y);
+        }
+    }
+    // Removing a source raises every tile closer to it than to the others,
+    // for a target moving a step that's about half the field, and raising,
+    // reseeding and propagating it costs more than one clean BFS. Only
+    // added sources are spread incrementally.
+    const bool removed = std::any_of(sources.begin(), sources.end(), [&](u32 idx) {
+        return std::find(next.begin(), next.end(), idx) == next.end();
+    });
+    sources = std::move(next);
+    if (removed) {
+        rebuild();
+        return;
+    }
+    for (const auto idx : sources) {
+        if (walkable[idx] && dist[idx] != 0) {
+            dist[idx] = 0;
+            seeds.push_back(idx);
+            touched.push_back(idx);
+        }
+    }
+    propagate();
+    update_dirs();
+}
+
+void Flow_field::on_tile_changed(const Map& map, Vec2u tile) {
+    if (tile.x >= width || tile.y >= height) {
+        return;
+    }
+    const u32 idx = tile.x + width * tile.y;
+    const bool now_walkable = is_walkable(map.at(tile));
+    if (now_walkable == (bool)walkable[idx]) {
+        return;
+    }
+    PROFILE_ZONE("flow_field_update");
+    walkable[idx] = now_walkable;
+    if (!now_walkable) {
+        // stays unreachable, reseeding skips tiles that can't be walked on
+        invalidate(idx);
+    } else {
+        uint16_t best = UNREACHABLE;
+        if (is_source(idx)) {
+            best = 0;
+        } else {
+            for_neighbours(idx, [&](u32 n) {
+                if (dist[n] != UNREACHABLE && dist[n] + 1 < best) {
+                    best = dist[n] + 1;
+                }
+            });
+        }
+        if (best != UNREACHABLE) {
+            dist[idx] = best;
+            seeds.push_back(idx);
+        }
+    }
+    touched.push_back(idx);
+    reseed_invalidated();
+    propagate();
+    update_dirs();
+}
+
+void Flow_field::rebuild() {
+    PROFILE_ZONE("flow_field_rebuild");
+    std::fill(dist.begin(), dist.end(), UNREACHABLE);
+    raised.clear();
+    seeds.clear();
+    touched.clear();
+    for (const auto idx : sources) {
+        if (walkable[idx]) {
+            dist[idx] = 0;
+            seeds.push_back(idx);
+        }
+    }
+    propagate();
+    touched.clear();
+    for (u32 idx = 0; idx < dist.size(); idx++) {
+        touched.push_back(idx);
+    }
+    update_dirs();
+}
+
+// Marks root and every tile whose only shortest path led through it as
+// unreachable. A tile at distance d keeps its value if any neighbour still
+// sits at d - 1.
+void Flow_field::invalidate(u32 root) {
+    if (dist[root] == UNREACHABLE) {
+        return;
+    }
+    size_t head = raised.size();
+    raised.push_back({root, dist[root]});
+    dist[root] = UNREACHABLE;
+    while (head < raised.size()) {
+        const auto [idx, old_dist] = raised[head++];
+        for_neighbours(idx, [&](u32 n) {
+            if (dist[n] != old_dist + 1) {
+                return;
+            }
+            bool supported = false;
+            for_neighbours(n, [&](u32 m) {
+                supported |= dist[m] == old_dist;
+            });
+            if (!supported) {
+                raised.push_back({n, dist[n]});
+                dist[n] = UNREACHABLE;
+            }
+        });
+    }
+}
+
+// Gives every invalidated tile the best distance offered by its still valid
+// neighbours, propagate() then settles the rest.
+void Flow_field::reseed_invalidated() {
+    if (raised.size() > dist.size() / 2) {
+        // most of the field is gone anyway, a clean BFS is cheaper
+        fallback_count++;
+        rebuild();
+        return;
+    }
+    for (const auto& [idx, old_dist] : raised) {
+        touched.push_back(idx);
+        if (!walkable[idx]) {
+            continue;
+        }
+        uint16_t best = dist[idx];
+        for_neighbours(idx, [&](u32 n) {
+            if (dist[n] != UNREACHABLE && dist[n] + 1 < best) {
+                best = dist[n] + 1;
+            }
+        });
+        if (best < dist[idx]) {
+            dist[idx] = best;
+            seeds.push_back(idx);
+        }
+    }
+    raised.clear();
+}
+
+// BFS from seeds that may start at different distances: the sorted seeds
+// are merged with the FIFO so tiles are expanded in distance order.
+void Flow_field::propagate() {
+    std::sort(seeds.begin(), seeds.end(), [&](u32 lhs, u32 rhs) {
+        return dist[lhs] < dist[rhs];
+    });
+    queue.clear();
+    size_t queue_head = 0;
+    size_t seed_head = 0;
+    while (queue_head < queue.size() || seed_head < seeds.size()) {
+        u32 idx;
+        if (seed_head < seeds.size() && (queue_head == queue.size()
+                    || dist[seeds[seed_head]] <= dist[queue[queue_head]])) {
+            idx = seeds[seed_head++];
+        } else {
+            idx = queue[queue_head++];
+        }
+        const uint16_t next = dist[idx] + 1;
+        for_neighbours(idx, [&](u32 n) {
+            if (walkable[n] && next < dist[n]) {
+                dist[n] = next;
+                queue.push_back(n);
+                touched.push_back(n);
+            }
+        });
+    }
+    seeds.clear();
+}
+
+void Flow_field::update_dirs() {
+    auto calc_dir = [&](u32 idx) {
+        const uint16_t own = dist[idx];
+        Flow_dir dir = FLOW_NONE;
+        if (own != UNREACHABLE && own != 0) {
+            const u32 x = idx % width;
+            const u32 y = idx / width;
+            uint16_t best = own;
+            auto consider = [&](u32 n, Flow_dir n_dir) {
+                if (dist[n] < best) {
+                    best = dist[n];
+                    dir = n_dir;
+                }
+            };
+            if (y > 0)              consider(idx - width, FLOW_UP);
+            if (y + 1 < height)     consider(idx + width, FLOW_DOWN);
+            if (x > 0)              consider(idx - 1, FLOW_LEFT);
+            if (x + 1 < width)      consider(idx + 1, FLOW_RIGHT);
+        }
+        dirs[idx] = dir;
+    };
+    // a changed distance can also change which way its neighbours point
+    for (const auto idx : touched) {
+        calc_dir(idx);
+        for_neighbours(idx, calc_dir);
+    }
+    touched.clear();
+}
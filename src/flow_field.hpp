@@ -0,0 +1,68 @@
+#ifndef RGL_FLOW_FIELD_HPP
+#define RGL_FLOW_FIELD_HPP
+
+#include "types_utils.hpp"
+#include "map.hpp"
+
+// step towards the nearest source, y grows downwards in tile space
+enum Flow_dir : byte {
+    FLOW_NONE,
+    FLOW_UP,
+    FLOW_DOWN,
+    FLOW_LEFT,
+    FLOW_RIGHT,
+};
+
+// Dijkstra map over the walkable tiles of a Map (4-connected, unit cost).
+// Holds the BFS distance to the closest source and the direction to step
+// for every tile. Tile changes and added sources are repaired
+// incrementally: only tiles whose shortest path went through the change are
+// invalidated and re-propagated, everything else is left untouched. Moving
+// or removing a source changes most of the field, so it's a plain BFS.
+struct Flow_field {
+    // distances are stored in exactly 16 bits, u16 is only a minimum
+    static constexpr uint16_t UNREACHABLE = UINT16_MAX;
+
+    u16 width;
+    u16 height;
+    Vec<uint16_t> dist;
+    Vec<Flow_dir> dirs;
+    Vec<byte>     walkable;
+    Vec<u32>      sources;
+    // incremental repairs that gave up and ran a full BFS instead
+    u64 fallback_count = 0;
+
+    explicit Flow_field(const Map& map);
+
+    void set_target(Vec2u tile);
+    void set_sources(const Vec<Vec2u>& tiles);
+    // call after the map tile at `tile` changed
+    void on_tile_changed(const Map& map, Vec2u tile);
+    // recomputes everything from the sources
+    void rebuild();
+
+    Flow_dir at(Vec2u tile) const {
+        return dirs[tile.x + width * tile.y];
+    }
+
+    uint16_t distance(Vec2u tile) const {
+        return dist[tile.x + width * tile.y];
+    }
+
+private:
+    // scratch buffers, kept to avoid allocating on every update
+    Vec<u32> seeds;
+    Vec<u32> queue;
+    Vec<u32> touched;
+    Vec<std::pair<u32, uint16_t>> raised;
+
+    template <typename F>
+    void for_neighbours(u32 idx, F&& f) const;
+    bool is_source(u32 idx) const;
+    void invalidate(u32 root);
+    void reseed_invalidated();
+    void propagate();
+    void update_dirs();
+};
+
+#endif // RGL_FLOW_FIELD_HPP
@@ -0,0 +1,185 @@
+#include "fov.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+
+void Tile_bits::resize(u16 w, u16 h) {
+    width = w;
+    height = h;
+    words.assign(((u32)w * h + 63) / 64, 0);
+}
+
+void Tile_bits::clear() {
+    std::fill(words.begin(), words.end(), 0);
+}
+
+Tile_bits& Tile_bits::operator |= (const Tile_bits& rhs) {
+    const size_t count = std::min(words.size(), rhs.words.size());
+    for (size_t i = 0; i < count; i++) {
+        words[i] |= rhs.words[i];
+    }
+    return *this;
+}
+
+Tile_bits& Tile_bits::operator &= (const Tile_bits& rhs) {
+    const size_t count = std::min(words.size(), rhs.words.size());
+    for (size_t i = 0; i < count; i++) {
+        words[i] &= rhs.words[i];
+    }
+    return *this;
+}
+
+static bool blocks_sight(Tile tile) {
+    return tile == Tile::Wall || tile == Tile::Unknown;
+}
+
+// octant transforms: (dx, dy) in octant space -> map offset
+constexpr Arr<Arr<i32, 4>, 8> OCTANTS = {{
+    {{ 1,  0,  0,  1}},
+    {{ 0,  1,  1,  0}},
+    {{ 0, -1,  1,  0}},
+    {{-1,  0,  0,  1}},
+    {{-1,  0,  0, -1}},
+    {{ 0, -1, -1,  0}},
+    {{ 0,  1, -1,  0}},
+    {{ 1,  0,  0, -1}},
+}};
+
+struct Shadowcast {
+    const Map& map;
+    Tile_bits& visible;
+    i32 ox, oy;
+    i32 radius;
+
+    void cast(i32 row, float start, float end, const Arr<i32, 4>& oct) {
+        if (start < end) {
+            return;
+        }
+        const i32 radius_sq = radius * radius;
+        float new_start = 0.f;
+        for (i32 j = row; j <= radius; j++) {
+            bool blocked = false;
+            const i32 dy = -j;
+            for (i32 dx = -j; dx <= 0; dx++) {
+                const float l_slope = (dx - 0.5f) / (dy + 0.5f);
+                const float r_slope = (dx + 0.5f) / (dy - 0.5f);
+                if (start < r_slope) {
+                    continue;
+                } else if (end > l_slope) {
+                    break;
+                }
+                const i32 x = ox + dx * oct[0] + dy * oct[1];
+                const i32 y = oy + dx * oct[2] + dy * oct[3];
+                const bool inside = x >= 0 && y >= 0 && x < (i32)map.width && y < (i32)map.height;
+                const bool opaque = !inside || blocks_sight(map.at(Vec2u{(u16)x, (u16)y}));
+                if (inside && dx * dx + dy * dy <= radius_sq) {
+                    visible.set(Vec2u{(u16)x, (u16)y});
+                }
+                if (blocked) {
+                    if (opaque) {
+                        new_start = r_slope;
+                        continue;
+                    }
+                    blocked = false;
+                    start = new_start;
+                } else if (opaque && j < radius) {
+                    blocked = true;
+                    cast(j + 1, start, l_slope, oct);
+                    new_start = r_slope;
+                }
+            }
+            if (blocked) {
+                break;
+            }
+        }
+    }
+};
+
+void compute_fov(const Map& map, Vec2u origin, u16 radius, Tile_bits& visible) {
+    PROFILE_ZONE("compute_fov");
+    if (visible.width != map.width || visible.height != map.height) {
+        visible.resize(map.width, map.height);
+    } else {
+        visible.clear();
+    }
+    if (origin.x >= map.width || origin.y >= map.height) {
+        return;
+    }
+    visible.set(origin);
+    Shadowcast caster {map, visible, (i32)origin.x, (i32)origin.y, (i32)radius};
+    for (const auto& oct : OCTANTS) {
+        caster.cast(1, 1.f, 0.f, oct);
+    }
+}
+
+bool Fov_cache::update(const Map& map, Vec2u new_viewer, u16 new_radius) {
+    if (!dirty && viewer == new_viewer && radius == new_radius) {
+        return false;
+    }
+    viewer = new_viewer;
+    radius = new_radius;
+    dirty = false;
+    compute_fov(map, viewer, radius, visible);
+    return true;
+}
+
+void Fov_cache::on_tile_changed(Vec2u tile) {
+    const i32 dx = (i32)tile.x - (i32)viewer.x;
+    const i32 dy = (i32)tile.y - (i32)viewer.y;
+    if (std::abs(dx) <= radius && std::abs(dy) <= radius) {
+        dirty = true;
+    }
+}
+
+bool Light_map::update(const Map& map) {
+    bool changed = width != map.width || height != map.height
+        || source_fovs.size() != sources.size();
+    if (changed) {
+        width = map.width;
+        height = map.height;
+        levels.resize((u32)width * height);
+        source_fovs.resize(sources.size());
+    }
+    for (size_t i = 0; i < sources.size(); i++) {
+        const auto& source = sources[i];
+        changed |= source_fovs[i].update(map, source.pos, source.radius);
+    }
+    // intensity changes alone don't invalidate the cached views
+    if (!changed && composed == sources) {
+        return false;
+    }
+    PROFILE_ZONE("compose_lights");
+    composed = sources;
+    std::fill(levels.begin(), levels.end(), 0);
+    for (size_t i = 0; i < sources.size(); i++) {
+        const auto& source = sources[i];
+        const auto& visible = source_fovs[i].visible;
+        const i32 radius = source.radius;
+        const u16 min_x = std::max<i32>(0, (i32)source.pos.x - radius);
+        const u16 min_y = std::max<i32>(0, (i32)source.pos.y - radius);
+        const u16 max_x = std::min<i32>(width - 1, source.pos.x + radius);
+        const u16 max_y = std::min<i32>(height - 1, source.pos.y + radius);
+        for (u16 y = min_y; y <= max_y; y++) {
+            for (u16 x = min_x; x <= max_x; x++) {
+                if (!visible.test(Vec2u{x, y})) {
+                    continue;
+                }
+                const float dx = (float)x - source.pos.x;
+                const float dy = (float)y - source.pos.y;
+                const float falloff = 1.f - std::sqrt(dx * dx + dy * dy) / (radius + 1);
+                if (falloff <= 0.f) {
+                    continue;
+                }
+                auto& level = levels[x + width * y];
+                level = std::min<u32>(255, level + (u32)(source.intensity * falloff));
+            }
+        }
+    }
+    return true;
+}
+
+void Light_map::on_tile_changed(Vec2u tile) {
+    for (auto& fov : source_fovs) {
+        fov.on_tile_changed(tile);
+    }
+}
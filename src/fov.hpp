@@ -0,0 +1,74 @@
+#ifndef RGL_FOV_HPP
+#define RGL_FOV_HPP
+
+#include "types_utils.hpp"
+#include "map.hpp"
+
+// One bit per map tile, row-major. Masks of the same size combine a whole
+// 64-bit word at a time.
+struct Tile_bits {
+    u16 width  = 0;
+    u16 height = 0;
+    Vec<u64> words;
+
+    void resize(u16 w, u16 h);
+    void clear();
+
+    bool test(Vec2u tile) const {
+        const u32 idx = tile.x + width * tile.y;
+        return (words[idx >> 6] >> (idx & 63)) & 1;
+    }
+
+    void set(Vec2u tile) {
+        const u32 idx = tile.x + width * tile.y;
+        words[idx >> 6] |= u64(1) << (idx & 63);
+    }
+
+    Tile_bits& operator |= (const Tile_bits& rhs);
+    Tile_bits& operator &= (const Tile_bits& rhs);
+};
+
+// recursive shadowcasting, walls and unknown tiles block sight
+void compute_fov(const Map& map, Vec2u origin, u16 radius, Tile_bits& visible);
+
+// Keeps the last result and recomputes only when the viewer enters another
+// tile, the radius changes or a tile within range changes.
+struct Fov_cache {
+    Tile_bits visible;
+    Vec2u viewer = {UINT16_MAX, UINT16_MAX};
+    u16   radius = 0;
+    bool  dirty  = true;
+
+    // returns true if the field of view was recomputed
+    bool update(const Map& map, Vec2u viewer, u16 radius);
+    void on_tile_changed(Vec2u tile);
+};
+
+struct Light_source {
+    Vec2u pos;
+    u16   radius;
+    byte  intensity;
+
+    bool operator == (const Light_source& rhs) const {
+        return pos == rhs.pos && radius == rhs.radius && intensity == rhs.intensity;
+    }
+};
+
+// Light level per tile, the sum of every source that can see the tile,
+// falling off linearly with distance and saturating at 255.
+struct Light_map {
+    u16 width  = 0;
+    u16 height = 0;
+    Vec<byte> levels;
+    Vec<Light_source> sources;
+    // one cached field of view per source
+    Vec<Fov_cache> source_fovs;
+    // sources the current levels were composed from
+    Vec<Light_source> composed;
+
+    // returns true if the levels changed
+    bool update(const Map& map);
+    void on_tile_changed(Vec2u tile);
+};
+
+#endif // RGL_FOV_HPP
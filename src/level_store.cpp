@@ -0,0 +1,303 @@
+#include "level_store.hpp"
+#include "compress.hpp"
+#include "profiler.hpp"
+#include <chrono>
+#include <cstring>
+#include <type_traits>
+
+size_t Level::resident_bytes() const {
+    size_t bytes = sizeof(Level)
+        + entities.capacity() * sizeof(Entity)
+        + physics_ids.capacity() * sizeof(ID)
+        + physics.capacity() * sizeof(Physics)
+        + anim_ids.capacity() * sizeof(ID)
+        + anims.capacity() * sizeof(Animation);
+    if (map != nullptr) {
+        bytes += map->resident_bytes();
+    }
+    return bytes;
+}
+
+// component arrays are stored as a u32 count followed by the raw elements
+template <typename T>
+static void put_array(Vec<byte>& out, const Vec<T>& items) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const uint32_t count = items.size();
+    const auto* count_bytes = reinterpret_cast<const byte*>(&count);
+    out.insert(out.end(), count_bytes, count_bytes + sizeof(count));
+    const auto* item_bytes = reinterpret_cast<const byte*>(items.data());
+    out.insert(out.end(), item_bytes, item_bytes + items.size() * sizeof(T));
+}
+
+template <typename T>
+static bool get_array(const Vec<byte>& in, size_t& pos, Vec<T>& items) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    uint32_t count;
+    if (pos + sizeof(count) > in.size()) {
+        return false;
+    }
+    memcpy(&count, in.data() + pos, sizeof(count));
+    pos += sizeof(count);
+    if (pos + (size_t)count * sizeof(T) > in.size()) {
+        return false;
+    }
+    items.resize(count);
+    memcpy(items.data(), in.data() + pos, count * sizeof(T));
+    pos += count * sizeof(T);
+    return true;
+}
+
+Packed_level pack_level(const Level& level) {
+    PROFILE_ZONE("pack_level");
+    Packed_level packed {
+        .depth = level.depth,
+        .dim = {level.map->width, level.map->height},
+        .up_stairs = level.up_stairs,
+        .down_stairs = level.down_stairs,
+    };
+    const auto& tiles = level.map->tiles;
+    packed.tiles = lz_compress(reinterpret_cast<const byte*>(tiles.data()),
+            tiles.size() * sizeof(Tile));
+
+    Vec<byte> raw;
+    put_array(raw, level.entities);
+    put_array(raw, level.physics_ids);
+    put_array(raw, level.physics);
+    put_array(raw, level.anim_ids);
+    put_array(raw, level.anims);
+    packed.components = lz_compress(raw.data(), raw.size());
+    return packed;
+}
+
+Uq_ptr<Level> unpack_level(const Packed_level& packed) {
+    PROFILE_ZONE("unpack_level");
+    Vec<byte> raw;
+    if (!lz_decompress(packed.tiles.data(), packed.tiles.size(), raw)
+            || raw.size() != (size_t)packed.dim.x * packed.dim.y * sizeof(Tile)) {
+        return nullptr;
+    }
+    Vec<Tile> tiles(raw.size() / sizeof(Tile));
+    memcpy(tiles.data(), raw.data(), raw.size());
+
+    auto level = std::make_unique<Level>();
+    level->depth = packed.depth;
+    level->map = std::make_unique<Map>(packed.dim, std::move(tiles), true);
+    level->up_stairs = packed.up_stairs;
+    level->down_stairs = packed.down_stairs;
+
+    size_t pos = 0;
+    if (!lz_decompress(packed.components.data(), packed.components.size(), raw)
+            || !get_array(raw, pos, level->entities)
+            || !get_array(raw, pos, level->physics_ids)
+            || !get_array(raw, pos, level->physics)
+            || !get_array(raw, pos, level->anim_ids)
+            || !get_array(raw, pos, level->anims)) {
+        return nullptr;
+    }
+    return level;
+}
+
+Level_store::Level_store(size_t budget, Generator gen)
+    : memory_budget(budget), generate(std::move(gen)) {
+    worker = std::thread(&Level_store::worker_loop, this);
+}
+
+Level_store::~Level_store() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    jobs_ready.notify_one();
+    worker.join();
+}
+
+Level_store::Slot* Level_store::find_slot(u32 depth) {
+    for (auto& slot : slots) {
+        if (slot.depth == depth) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+bool Level_store::is_pinned(u32 depth) const {
+    return depth + 1 >= active && depth <= active + 1;
+}
+
+Level_store::Slot& Level_store::request(u32 depth) {
+    Slot* slot = find_slot(depth);
+    if (slot == nullptr) {
+        slot = &slots.emplace_back();
+        slot->depth = depth;
+        slot->state = BUSY;
+        jobs.push_back({JOB_GENERATE, slot});
+    } else if (slot->state == PACKED) {
+        slot->state = BUSY;
+        jobs.push_back({JOB_UNPACK, slot});
+    } else if (slot->state == BUSY) {
+        // still resident if it was only queued for packing
+        for (auto job = jobs.begin(); job != jobs.end(); job++) {
+            if (job->slot == slot && job->type == JOB_PACK) {
+                jobs.erase(job);
+                slot->state = RESIDENT;
+                break;
+            }
+        }
+    }
+    slot->last_used = ++use_clock;
+    jobs_ready.notify_one();
+    return *slot;
+}
+
+Level& Level_store::enter(u32 depth) {
+    PROFILE_ZONE("level_switch");
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock lock(mutex);
+    // the caller is done with the previous level, its size is settled
+    if (Slot* prev = find_slot(active); prev != nullptr && prev->state == RESIDENT) {
+        prev->bytes = prev->level->resident_bytes();
+    }
+    active = depth;
+    Slot& slot = request(depth);
+    const bool hit = slot.state == RESIDENT;
+    // A prefetch the worker already started can't be cut short, so a
+    // queued job for the active level runs right here instead of waiting
+    // behind it. Only a job the worker is already on is waited for.
+    auto take_job = [&](Job& taken) {
+        for (auto job = jobs.begin(); job != jobs.end(); job++) {
+            if (job->slot == &slot) {
+                taken = *job;
+                jobs.erase(job);
+                return true;
+            }
+        }
+        return false;
+    };
+    while (slot.state != RESIDENT) {
+        Job job;
+        if (take_job(job)) {
+            run_job(job, lock);
+            continue;
+        }
+        slot_ready.wait(lock, [&] { return slot.state != BUSY; });
+        // it was being packed, queue it right back
+        if (slot.state == PACKED) {
+            request(depth);
+        }
+    }
+
+    request(depth + 1);
+    if (depth > 0) {
+        request(depth - 1);
+    }
+    evict_over_budget();
+
+    last_stats.last_switch_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+    last_stats.last_switch_hit = hit;
+    return *slot.level;
+}
+
+void Level_store::evict_over_budget() {
+    // the pinned levels stay no matter what, only the others count
+    size_t resident = 0;
+    for (const auto& slot : slots) {
+        if (slot.state == RESIDENT && !is_pinned(slot.depth)) {
+            resident += slot.bytes;
+        }
+    }
+    while (resident > memory_budget) {
+        Slot* lru = nullptr;
+        for (auto& slot : slots) {
+            if (slot.state == RESIDENT && !is_pinned(slot.depth)
+                    && (lru == nullptr || slot.last_used < lru->last_used)) {
+                lru = &slot;
+            }
+        }
+        if (lru == nullptr) {
+            break;
+        }
+        resident -= lru->bytes;
+        lru->state = BUSY;
+        jobs.push_back({JOB_PACK, lru});
+        jobs_ready.notify_one();
+    }
+}
+
+Level_store_stats Level_store::stats() const {
+    std::lock_guard lock(mutex);
+    Level_store_stats stats = last_stats;
+    for (const auto& slot : slots) {
+        // busy slots belong to the worker, they're counted once it's done
+        if (slot.state == RESIDENT) {
+            stats.resident_bytes += slot.bytes;
+            stats.resident_levels++;
+        } else if (slot.state == PACKED) {
+            stats.packed_bytes += slot.packed.packed_bytes();
+            stats.packed_levels++;
+        }
+    }
+    return stats;
+}
+
+void Level_store::worker_loop() {
+    PROFILE_THREAD("level_store");
+    std::unique_lock lock(mutex);
+    while (true) {
+        jobs_ready.wait(lock, [&] { return stopping || !jobs.empty(); });
+        if (stopping) {
+            return;
+        }
+        const Job job = jobs.front();
+        jobs.pop_front();
+        run_job(job, lock);
+    }
+}
+
+// called with the lock held, it's released while the job works
+void Level_store::run_job(const Job& job, std::unique_lock<std::mutex>& lock) {
+    Slot& slot = *job.slot;
+    if (job.type == JOB_PACK && is_pinned(slot.depth)) {
+        // the player came back before it was packed
+        slot.state = RESIDENT;
+        slot_ready.notify_all();
+        return;
+    }
+
+    lock.unlock();
+    Uq_ptr<Level> level;
+    Packed_level packed;
+    switch (job.type) {
+        case JOB_GENERATE: {
+            PROFILE_ZONE("generate_level");
+            level = generate(slot.depth);
+            level->depth = slot.depth;
+            break;
+        }
+        case JOB_PACK:
+            packed = pack_level(*slot.level);
+            break;
+        case JOB_UNPACK:
+            level = unpack_level(slot.packed);
+            break;
+    }
+    lock.lock();
+
+    if (job.type == JOB_PACK) {
+        slot.packed = std::move(packed);
+        slot.level.reset();
+        slot.state = PACKED;
+    } else if (level == nullptr) {
+        LOG_ERR("Level {} failed to unpack, generating it again", slot.depth);
+        slot.packed = Packed_level{};
+        jobs.push_front({JOB_GENERATE, &slot});
+        return;
+    } else {
+        slot.level = std::move(level);
+        slot.bytes = slot.level->resident_bytes();
+        slot.packed = Packed_level{};
+        slot.state = RESIDENT;
+    }
+    evict_over_budget();
+    slot_ready.notify_all();
+}
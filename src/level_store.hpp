@@ -0,0 +1,138 @@
+#ifndef RGL_LEVEL_STORE_HPP
+#define RGL_LEVEL_STORE_HPP
+
+#include "types_utils.hpp"
+#include "entity.hpp"
+#include "map.hpp"
+#include "physics.hpp"
+#include "animation.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Everything that belongs to one dungeon level. The entities and their
+// components are parked here while the level isn't the active one.
+struct Level {
+    u32 depth = 0;
+    Uq_ptr<Map> map;
+    // where the player arrives coming down / coming back up
+    Vec2u up_stairs;
+    Vec2u down_stairs;
+
+    Vec<Entity>    entities;
+    Vec<ID>        physics_ids;
+    Vec<Physics>   physics;
+    Vec<ID>        anim_ids;
+    Vec<Animation> anims;
+
+    size_t resident_bytes() const;
+};
+
+// A level squeezed for long term storage: the tile grid and the serialized
+// entity and component arrays, both LZ compressed. The WFC solver state is
+// dropped and rebuilt from the tiles on the way back.
+struct Packed_level {
+    u32   depth = 0;
+    Vec2u dim;
+    Vec2u up_stairs;
+    Vec2u down_stairs;
+    Vec<byte> tiles;
+    Vec<byte> components;
+
+    size_t packed_bytes() const {
+        return sizeof(Packed_level) + tiles.capacity() + components.capacity();
+    }
+};
+
+Packed_level pack_level(const Level& level);
+// returns nullptr if the packed data is corrupt
+Uq_ptr<Level> unpack_level(const Packed_level& packed);
+
+struct Level_store_stats {
+    size_t resident_bytes = 0;
+    size_t packed_bytes   = 0;
+    u32    resident_levels = 0;
+    u32    packed_levels   = 0;
+    // how long the last enter() blocked and whether the level was ready
+    double last_switch_ms = 0.0;
+    bool   last_switch_hit = false;
+};
+
+// Owns every visited level. The active level and its neighbours stay
+// resident outside the memory budget; once the other resident levels
+// outgrow it the least recently used of them are packed. A worker thread packs, unpacks
+// and generates levels ahead of time so switching to a neighbour is
+// normally just a lookup.
+//
+// The level returned by enter() belongs to the caller until the next
+// enter(), the store only measures and packs it after that.
+struct Level_store {
+    // makes a fresh level, called on the worker thread or, for the level
+    // being entered, in enter(); two calls may run at once
+    using Generator = std::function<Uq_ptr<Level>(u32 depth)>;
+
+    Level_store(size_t memory_budget, Generator generate);
+    ~Level_store();
+
+    // makes `depth` the active level, blocking until it's resident. A
+    // level that isn't prefetched yet is generated or unpacked in place,
+    // it only waits for the worker if the worker already started on it.
+    Level& enter(u32 depth);
+    Level_store_stats stats() const;
+
+private:
+    enum Slot_state : byte {
+        RESIDENT,
+        PACKED,
+        // the worker owns the slot until it's done with it
+        BUSY,
+    };
+
+    struct Slot {
+        u32 depth = 0;
+        Slot_state state = BUSY;
+        Uq_ptr<Level> level;
+        Packed_level packed;
+        // resident size, measured whenever the level changes hands
+        size_t bytes = 0;
+        u64 last_used = 0;
+    };
+
+    enum Job_type : byte {
+        JOB_GENERATE,
+        JOB_PACK,
+        JOB_UNPACK,
+    };
+
+    struct Job {
+        Job_type type;
+        Slot*    slot;
+    };
+
+    const size_t memory_budget;
+    const Generator generate;
+
+    mutable std::mutex mutex;
+    std::condition_variable jobs_ready;
+    std::condition_variable slot_ready;
+    std::deque<Job> jobs;
+    // slots never move, the worker keeps pointers to them
+    std::deque<Slot> slots;
+    u32  active = 0;
+    u64  use_clock = 0;
+    bool stopping = false;
+    Level_store_stats last_stats;
+    std::thread worker;
+
+    Slot* find_slot(u32 depth);
+    bool is_pinned(u32 depth) const;
+    // queues whatever it takes to make `depth` resident, returns the slot
+    Slot& request(u32 depth);
+    void evict_over_budget();
+    void run_job(const Job& job, std::unique_lock<std::mutex>& lock);
+    void worker_loop();
+};
+
+#endif // RGL_LEVEL_STORE_HPP
@@ -0,0 +1,121 @@
+#include "logger.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+// Bounded MPSC queue (Vyukov): a slot is free for position `pos` when its
+// sequence equals `pos` and readable when it equals `pos + 1`.
+struct Logger {
+    std::unique_ptr<Log_record[]> records;
+    alignas(64) std::atomic<size_t> enqueue_pos = 0;
+    alignas(64) std::atomic<size_t> dequeue_pos = 0;
+    std::atomic<size_t> dropped = 0;
+    std::atomic<bool>   running = true;
+    std::thread         worker;
+
+    Logger(): records(new Log_record[LOG_QUEUE_SIZE]) {
+        for (size_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+            records[i].seq.store(i, std::memory_order_relaxed);
+        }
+        worker = std::thread([this]() { run(); });
+    }
+
+    ~Logger() {
+        running.store(false, std::memory_order_release);
+        worker.join();
+    }
+
+    // returns false if there was nothing to write
+    bool drain(fmt::memory_buffer& out) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        const size_t first = pos;
+        for (;;) {
+            Log_record& record = records[pos & (LOG_QUEUE_SIZE - 1)];
+            if (record.seq.load(std::memory_order_acquire) != pos + 1) {
+                break;
+            }
+            out.clear();
+            switch (record.level) {
+                case Log_level::error:
+                    out.append(fmt::string_view("\033[1;31m"));
+                    record.format(out, record);
+                    out.append(fmt::string_view("\033[0m\n"));
+                    std::fwrite(out.data(), 1, out.size(), stderr);
+                    break;
+                case Log_level::debug:
+                    out.append(fmt::string_view("\033[1;33m"));
+                    record.format(out, record);
+                    out.append(fmt::string_view("\033[0m\n"));
+                    std::fwrite(out.data(), 1, out.size(), stderr);
+                    break;
+                default:
+                    record.format(out, record);
+                    out.push_back('\n');
+                    std::fwrite(out.data(), 1, out.size(), stdout);
+                    break;
+            }
+            record.seq.store(pos + LOG_QUEUE_SIZE, std::memory_order_release);
+            pos++;
+            dequeue_pos.store(pos, std::memory_order_release);
+        }
+        const size_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0) {
+            fmt::print(stderr, "\033[1;31m[log] dropped {} messages\033[0m\n", lost);
+        }
+        if (pos != first) {
+            std::fflush(stdout);
+            std::fflush(stderr);
+            return true;
+        }
+        return false;
+    }
+
+    void run() {
+        fmt::memory_buffer out;
+        while (running.load(std::memory_order_acquire)) {
+            if (!drain(out)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        drain(out);
+    }
+};
+
+static Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+Log_record* log_claim(size_t& pos) {
+    Logger& log = logger();
+    pos = log.enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        Log_record& record = log.records[pos & (LOG_QUEUE_SIZE - 1)];
+        const size_t seq = record.seq.load(std::memory_order_acquire);
+        const auto diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (log.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return &record;
+            }
+        } else if (diff < 0) {
+            log.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = log.enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void log_commit(Log_record* record, size_t pos) {
+    record->seq.store(pos + 1, std::memory_order_release);
+}
+
+void log_flush() {
+    Logger& log = logger();
+    const size_t target = log.enqueue_pos.load(std::memory_order_acquire);
+    while (log.dequeue_pos.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef RGL_LOGGER_HPP
+#define RGL_LOGGER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fmt/format.h>
+#include <new>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Asynchronous logger.
+// LOG* macros copy their arguments into a slot of a bounded lock-free MPSC
+// ring, a background thread formats and prints them. Producers never block:
+// when the ring is full the message is dropped and counted.
+// Messages whose arguments aren't all numbers or enums (strings, views,
+// structs) or don't fit a slot are formatted on the calling thread instead.
+
+enum class Log_level : uint8_t {
+    debug,
+    info,
+    error,
+    off,
+};
+
+// compile-time filter, anything below is removed from the build
+#ifndef RGL_LOG_LEVEL
+#ifdef DEBUG
+#define RGL_LOG_LEVEL Log_level::debug
+#else
+#define RGL_LOG_LEVEL Log_level::info
+#endif
+#endif
+
+constexpr size_t LOG_RECORD_SIZE = 256;
+constexpr size_t LOG_QUEUE_SIZE  = 4096; // must be a power of two
+
+struct Log_record;
+using Log_format_fn = void (*)(fmt::memory_buffer& out, const Log_record& record);
+
+struct Log_record {
+    std::atomic<size_t> seq;
+    Log_format_fn       format;
+    fmt::string_view    format_str;
+    uint32_t            size;
+    Log_level           level;
+    // everything above takes 40 bytes
+    alignas(8) unsigned char payload[LOG_RECORD_SIZE - 40];
+};
+static_assert(sizeof(Log_record) == LOG_RECORD_SIZE);
+
+// runtime filter
+inline std::atomic<Log_level> log_runtime_level = RGL_LOG_LEVEL;
+
+inline void log_set_level(Log_level level) {
+    log_runtime_level.store(level, std::memory_order_relaxed);
+}
+
+inline bool log_enabled(Log_level level) {
+    return level >= log_runtime_level.load(std::memory_order_relaxed);
+}
+
+// returns nullptr when the queue is full, commit with log_commit
+Log_record* log_claim(size_t& pos);
+void log_commit(Log_record* record, size_t pos);
+// blocks until everything pushed so far has been written out
+void log_flush();
+
+// Only plain values are known to stay valid until the background thread
+// formats them. Views, spans, fmt::join() and structs holding pointers are
+// trivially copyable too but may point at data that is gone by then.
+template <typename T>
+constexpr bool log_deferrable = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+template <typename... Args>
+void log_push(Log_level level, fmt::format_string<Args...> format, Args&&... args) {
+    size_t pos;
+    Log_record* record = log_claim(pos);
+    if (record == nullptr) {
+        return;
+    }
+    record->level = level;
+    using Payload = std::tuple<std::decay_t<Args>...>;
+    if constexpr ((log_deferrable<std::decay_t<Args>> && ...)
+            && sizeof(Payload) <= sizeof(record->payload)
+            && alignof(Payload) <= 8) {
+        new (record->payload) Payload(std::forward<Args>(args)...);
+        record->format_str = static_cast<fmt::string_view>(format);
+        record->format = [](fmt::memory_buffer& out, const Log_record& rec) {
+            const auto& payload = *std::launder(reinterpret_cast<const Payload*>(rec.payload));
+            std::apply([&](const auto&... values) {
+                fmt::vformat_to(std::back_inserter(out), rec.format_str,
+                        fmt::make_format_args(values...));
+            }, payload);
+        };
+    } else {
+        auto result = fmt::format_to_n(
+            reinterpret_cast<char*>(record->payload), sizeof(record->payload),
+            format, std::forward<Args>(args)...);
+        record->size = result.size < sizeof(record->payload)
+            ? result.size : sizeof(record->payload);
+        record->format = [](fmt::memory_buffer& out, const Log_record& rec) {
+            const char* text = reinterpret_cast<const char*>(rec.payload);
+            out.append(text, text + rec.size);
+        };
+    }
+    log_commit(record, pos);
+}
+
+#define LOG_AT(level, ...) do { \
+        if constexpr (level >= RGL_LOG_LEVEL) { \
+            if (log_enabled(level)) log_push(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG(...)        LOG_AT(Log_level::info, __VA_ARGS__)
+#define LOG_ERR(...)    LOG_AT(Log_level::error, __VA_ARGS__)
+#define LOG_DBG(...)    LOG_AT(Log_level::debug, __VA_ARGS__)
+
+#endif // RGL_LOGGER_HPP
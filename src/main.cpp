@@ -1,5 +1,9 @@
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <fmt/printf.h>
+#include <random>
+#include <thread>
 #include <unordered_map>
 
 #include <SDL2/SDL.h>
@@ -12,21 +16,80 @@
 #include "physics.hpp"
 #include "map.hpp"
 #include "renderable.hpp"
-
-#define DEBUG
-
+#include "profiler.hpp"
+#include "animation.hpp"
+#include "sync.hpp"
+#include "flow_field.hpp"
+#include "fov.hpp"
+#include "level_store.hpp"
+#include "snapshot.hpp"
+#include "alloc.hpp"
+#include "particles.hpp"
+
+// owned by the simulation thread once it's running
 static std::vector<Entity> entities;
 static std::vector<ID> player_entities;
 
-static std::unordered_map<ID, Physics> physics_comps;
+static Component_pool<Physics> physics_comps;
+static Animations animations;
+
+// owned by the main thread
 static std::unordered_map<ID, Renderable> render_comps;
 
+struct Input_event {
+    SDL_Keycode key;
+    MoveType    type;
+};
+
+// main thread -> simulation
+static Spsc_queue<Input_event, 256> input_queue;
+// simulation -> main thread
+static Triple_buffer<Render_snapshot> snapshots;
+static Spsc_queue<Map_chunk, 256> chunk_queue;
+static Spsc_queue<Particle_burst, 256> particle_queue;
+static std::atomic<bool> sim_running = false;
+
 constexpr u64 fps_cap = 240;
 constexpr u64 frame_min_dur = 1'000 / fps_cap;
 
+// fixed simulation rate, physics is tuned per tick
+constexpr u64 sim_tick_rate = 240;
+constexpr float sim_tick_ms = 1'000.f / sim_tick_rate;
+// ticks the simulation may fall behind before it stops catching up
+constexpr u64 sim_max_lag = 8;
+
+// in tiles
+constexpr u16 player_view_radius = 10;
+constexpr u16 player_light_radius = 7;
+// tiles around the player re-generated by the carve key
+constexpr u16 carve_radius = 2;
+
+constexpr Vec2u level_dim = {32, 24};
+constexpr Vec2u level_spawn = {16, 12};
+// uncompressed levels kept beyond the active one and its neighbours, a
+// 32x24 level with its solver is 67-132 KiB
+constexpr size_t level_memory_budget = 512 * 1024;
+// a snapshot is recorded every tick, a few dozen bytes once compressed
+constexpr size_t rewind_memory_budget = 1024 * 1024;
+
+// per frame scratch, anything past it falls back to the heap
+constexpr size_t frame_arena_size = 256 * 1024;
+// frames between allocation reports
+constexpr u64 alloc_report_frames = 1'200;
+
+// live particles at once, bursts beyond it are cut short
+constexpr u32 max_particles = 16 * 1024;
+// longest step particles take, so a stalled frame doesn't fling them
+constexpr float particle_max_step_ms = 50.f;
+
 constexpr u64 sprite_ani_fps = 10;
 constexpr u64 sprite_frame_dur = 1'000 / sprite_ani_fps;
 
+static Clip_id player_walk_clip;
+
+constexpr const char* trace_filename = "rogalik_trace.json";
+constexpr const char* quicksave_filename = "rogalik_quicksave.bin";
+
 struct Settings {
     u32 width  = 800;
     u32 height = 600;
@@ -46,32 +109,73 @@ void spawn_player(Position spawn_pos) {
     player_phys.loc = Location::air;
     player_phys.pos = spawn_pos;
 
-    physics_comps[player.id] = player_phys;
+    physics_comps.add(player.id, player_phys);
 
     player_entities.push_back(player.id);
+    animations.play(player.id, player_walk_clip);
 }
 
-void handle_events(SDL_Event& event, MoveType type) {
-    using Dir = Direction;
-    if (event.key.keysym.sym == SDLK_q) {
-        STATE = GameState::stopping;
+// runs on the simulation thread, the particles themselves live on the
+// main thread; bursts that don't fit the queue are simply not shown
+void emit_particles(const Physics& comp, Physics_event event) {
+    Particle_burst burst {
+        .pos = comp.pos,
+        .vel_x = comp.vel.x * sim_tick_rate,
+        .vel_y = comp.vel.y * sim_tick_rate,
+    };
+    switch (event) {
+        case EVENT_JUMPED:
+            burst.kind = PARTICLE_DUST;
+            burst.count = 12;
+            particle_queue.push(burst);
+            break;
+        case EVENT_LANDED:
+            burst.kind = PARTICLE_DUST;
+            burst.count = 24;
+            particle_queue.push(burst);
+            burst.kind = PARTICLE_DEBRIS;
+            burst.count = 6;
+            particle_queue.push(burst);
+            break;
+        case EVENT_HIT_WALL:
+            burst.kind = PARTICLE_SPARK;
+            burst.count = 16;
+            particle_queue.push(burst);
+            break;
+        default:
+            break;
     }
+}
 
+// runs on the simulation thread
+void handle_input(const Input_event& input) {
+    using Dir = Direction;
     for (const auto& id : player_entities) {
         auto& comp = physics_comps.at(id);
-        switch (event.key.keysym.sym) {
-            case SDLK_LEFT:     update_move(comp, Dir::left, type); break;
-            case SDLK_RIGHT:    update_move(comp, Dir::right,type); break;
+        switch (input.key) {
+            case SDLK_LEFT:     update_move(comp, Dir::left, input.type); break;
+            case SDLK_RIGHT:    update_move(comp, Dir::right,input.type); break;
 
-            case SDLK_UP:       update_move(comp, Dir::jump, type); break;
-            case SDLK_SPACE:    update_move(comp, Dir::jump, type); break;
+            case SDLK_UP:
+            case SDLK_SPACE:    emit_particles(comp, update_move(comp, Dir::jump, input.type)); break;
         }
-        auto& rend = render_comps.at(id);
-        rend.dir = comp.dir;
+    }
+}
+
+void handle_events(SDL_Event& event, MoveType type) {
+    if (event.key.keysym.sym == SDLK_q) {
+        STATE = GameState::stopping;
+    }
+    if (event.key.keysym.sym == SDLK_p && type == MoveType::move) {
+        profiler_export_chrome_trace(trace_filename);
+    }
+    if (!input_queue.push({event.key.keysym.sym, type})) {
+        LOG_ERR("Input queue full, dropped a key event");
     }
 }
 
 void poll_events(SDL_Event& event) {
+    PROFILE_ZONE("poll_events");
     while (SDL_PollEvent(&event) != 0) {
         switch (event.type) {
             case SDL_QUIT:      STATE = GameState::stopping; break;
@@ -81,55 +185,355 @@ void poll_events(SDL_Event& event) {
     }
 }
 
-void handle_entities(SDL_Window* wndw, SDL_Renderer* rndr, const Map& map) {
+void simulate_entities(const Map& map) {
     for (const auto& entity : entities) {
         if (entity.flags & PHYSICS_FLAG) {
             auto& comp = physics_comps.at(entity.id);
-            update_tick(comp, map);
+            PROFILE_ZONE("update_tick");
+            emit_particles(comp, update_tick(comp, map));
+        }
+    }
+}
+
+void publish_snapshot(u64 tick, const Fov_cache& fov, const Light_map& lights) {
+    PROFILE_ZONE("publish_snapshot");
+    auto& snap = snapshots.write_buffer();
+    snap.tick = tick;
+    snap.visible = fov.visible;
+    snap.light = lights.levels;
+    snap.sprites.clear();
+    for (const auto& entity : entities) {
+        if (!(entity.flags & RENDER_FLAG)) {
+            continue;
+        }
+        Sprite_instance inst {.id = entity.id, .dir = Direction::none, .frame = 0};
+        if (entity.flags & PHYSICS_FLAG) {
+            const auto& comp = physics_comps.at(entity.id);
+            inst.pos = comp.pos;
+            inst.dir = comp.dir;
+        }
+        if (const auto* anim = animations.comps.find(entity.id)) {
+            inst.frame = animations.sprite_of(*anim);
+        }
+        snap.sprites.push_back(inst);
+    }
+    snapshots.publish();
+}
+
+// simulation-side state derived from the map
+struct Map_systems {
+    // distances towards the player for anything chasing them
+    Flow_field  player_flow;
+    Fov_cache   player_fov;
+    Light_map   lights;
+    Vec2u       player_tile = {UINT16_MAX, UINT16_MAX};
+
+    explicit Map_systems(const Map& map): player_flow(map) {}
+
+    void on_tile_changed(const Map& map, Vec2u tile) {
+        player_flow.on_tile_changed(map, tile);
+        player_fov.on_tile_changed(tile);
+        lights.on_tile_changed(tile);
+    }
+};
+
+void carve_at_player(Map& map, Map_systems& systems) {
+    if (player_entities.empty()) {
+        return;
+    }
+    const auto tile = map.tile_of(physics_comps.at(player_entities.front()).pos);
+    for (const auto& changed : map.edit(tile, Tile::Empty, carve_radius)) {
+        systems.on_tile_changed(map, changed);
+    }
+}
+
+// picked once at startup, every level's layout follows from it
+static uint32_t run_seed = 1;
+
+// A fixed seed per depth: levels generated within the same second would
+// share the clock seed and come out identical, and a level regenerated
+// after a failed unpack gets its old layout back.
+u32 level_seed(u32 depth) {
+    // splitmix64 finalizer, neighbouring depths end up far apart
+    uint64_t z = ((uint64_t)run_seed << 32 | depth) + 0x9e3779b97f4a7c15;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    z ^= z >> 31;
+    // 0 would make Map fall back to the clock
+    const uint32_t seed = (uint32_t)z;
+    return seed != 0 ? seed : 1;
+}
+
+// runs on the level store's worker, or in enter() for the level entered
+Uq_ptr<Level> generate_level(u32 depth) {
+    auto level = std::make_unique<Level>();
+    level->map = std::make_unique<Map>(level_dim, level_spawn, true, level_seed(depth));
+    auto& map = *level->map;
+    level->up_stairs = level_spawn;
+    level->down_stairs = level_spawn;
+
+    // the way down goes on the walkable tile farthest from the way up
+    Flow_field from_spawn(map);
+    from_spawn.set_target(level_spawn);
+    u16 farthest = 0;
+    for (u16 y = 0; y < map.height; y++) {
+        for (u16 x = 0; x < map.width; x++) {
+            const uint16_t dist = from_spawn.distance(Vec2u{x, y});
+            if (dist != Flow_field::UNREACHABLE && dist > farthest) {
+                farthest = dist;
+                level->down_stairs = Vec2u{x, y};
+            }
+        }
+    }
+    map.edit(level->down_stairs, Tile::Stairs, 0);
+    if (depth > 0) {
+        map.edit(level->up_stairs, Tile::Stairs, 0);
+    }
+    map.take_dirty_chunks();
+    const auto& stats = map.generation_stats;
+    LOG("Level {} generated: WFC arena {} allocations, {} KiB reserved, "
+            "process peak RSS {} KiB", depth, stats.allocations, stats.reserved / 1024,
+            peak_rss_bytes() / 1024);
+    return level;
+}
+
+// parks everything but the players in the level being left
+void stash_level_entities(Level& level) {
+    Vec<Entity> kept;
+    for (const auto& entity : entities) {
+        if (entity.flags & PLAYER_FLAG) {
+            kept.push_back(entity);
+            continue;
+        }
+        level.entities.push_back(entity);
+        if (const auto* comp = physics_comps.find(entity.id)) {
+            level.physics_ids.push_back(entity.id);
+            level.physics.push_back(*comp);
+            physics_comps.remove(entity.id);
+        }
+        if (const auto* anim = animations.comps.find(entity.id)) {
+            level.anim_ids.push_back(entity.id);
+            level.anims.push_back(*anim);
+            animations.comps.remove(entity.id);
+        }
+    }
+    entities = std::move(kept);
+}
 
-            if (entity.flags & RENDER_FLAG) {
-                //LOG_DBG("{} {}", comp.pos.x, comp.pos.y);
-                auto& rend = render_comps.at(entity.id);
-                rend.pos.x = comp.pos.x;
-                rend.pos.y = comp.pos.y;
+void restore_level_entities(Level& level) {
+    vec_append(entities, level.entities);
+    for (size_t i = 0; i < level.physics.size(); i++) {
+        physics_comps.add(level.physics_ids[i], level.physics[i]);
+    }
+    for (size_t i = 0; i < level.anims.size(); i++) {
+        animations.comps.add(level.anim_ids[i], level.anims[i]);
+    }
+    level.entities.clear();
+    level.physics_ids.clear();
+    level.physics.clear();
+    level.anim_ids.clear();
+    level.anims.clear();
+}
+
+// takes the stairs, the player lands on the matching stairs of the new level
+Level& switch_level(Level_store& store, Level& from, u32 depth) {
+    stash_level_entities(from);
+    Level& to = store.enter(depth);
+    restore_level_entities(to);
+    const Vec2u arrival = depth > from.depth ? to.up_stairs : to.down_stairs;
+    for (const auto& id : player_entities) {
+        auto& comp = physics_comps.at(id);
+        comp.pos = to.map->position_of(arrival);
+        comp.vel = {};
+        comp.loc = Location::air;
+    }
+
+    const auto stats = store.stats();
+    LOG("Level {}: switch took {:.3f} ms ({}), {} KiB resident in {} levels, "
+            "{} KiB packed in {} levels", depth, stats.last_switch_ms,
+            stats.last_switch_hit ? "prefetched" : "waited",
+            stats.resident_bytes / 1024, stats.resident_levels,
+            stats.packed_bytes / 1024, stats.packed_levels);
+    return to;
+}
+
+bool on_tile(const Map& map, Vec2u tile) {
+    if (player_entities.empty()) {
+        return false;
+    }
+#ifdef DEBUG
+    // stairs can be taken from anywhere while testing
+    return true;
+#else
+    return map.tile_of(physics_comps.at(player_entities.front()).pos) == tile;
+#endif
+}
+
+// replaces the entities, components and tiles with the snapshot's,
+// the snapshot has to be of the current level
+void load_snapshot(const Snapshot_view& snap, Map& map, Map_systems& systems) {
+    PROFILE_ZONE("load_snapshot");
+    if (!(snap.dim == Vec2u{map.width, map.height})) {
+        LOG_ERR("Snapshot is {}x{}, the map {}x{}", snap.dim.x, snap.dim.y, map.width, map.height);
+        return;
+    }
+    entities.assign(snap.entities.begin(), snap.entities.end());
+    player_entities.clear();
+    for (const auto& entity : entities) {
+        if (entity.flags & PLAYER_FLAG) {
+            player_entities.push_back(entity.id);
+        }
+        reserve_entity_ids(entity.id);
+    }
+    physics_comps.assign(snap.physics_ids.data(), snap.physics.data(), snap.physics.size());
+    animations.comps.assign(snap.anim_ids.data(), snap.anims.data(), snap.anims.size());
+
+    for (u16 y = 0; y < map.height; y++) {
+        for (u16 x = 0; x < map.width; x++) {
+            const Tile tile = snap.tiles[x + map.width * y];
+            if (map.tiles[x + map.width * y] == tile) {
+                continue;
+            }
+            for (const auto& changed : map.edit(Vec2u{x, y}, tile, 0)) {
+                systems.on_tile_changed(map, changed);
             }
         }
+    }
+}
+
+void simulation_loop(Level_store& store) {
+    PROFILE_THREAD("simulation");
+    using Clock = std::chrono::steady_clock;
+    const auto tick_dur = std::chrono::nanoseconds(1'000'000'000 / sim_tick_rate);
+    auto next_tick = Clock::now();
+    u64 tick = 0;
+
+    Level* level = &store.enter(0);
+    Map_systems systems(*level->map);
+    // edited chunks the main thread hasn't received yet
+    Vec<Vec2u> pending_chunks;
+
+    Snapshot_writer writer;
+    Rewind_buffer rewind(rewind_memory_budget);
+    Vec<byte> snapshot_bytes;
+    Vec<byte> loaded_bytes;
+    bool rewinding = false;
+    auto snapshot_source = [&]() -> Snapshot_source {
+        return {tick, level->depth, *level->map, entities, physics_comps, animations.comps};
+    };
 
-        // rendering TODO: Move out of the function
-        if (entity.flags & RENDER_FLAG) {
-            SDL_SetRenderDrawColor(rndr, 0, 0, 0, 255);
-            auto& elem = render_comps.at(entity.id);
-            // render 
-            SDL_Rect rect = {
-                (int)(elem.pos.x / Position::MAX * CONF.width),
-                (int)(CONF.height - (elem.pos.y / Position::MAX * CONF.height) - elem.bnd.y), 
-                elem.bnd.x, 
-                elem.bnd.y
-            };
-            static byte frame = 0;
-            static unsigned subframe = 0;
-            const auto count_frames = elem.sprites.size();
-            SDL_RendererFlip mirror_flip = 
-                elem.dir == Direction::left ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
-            if (count_frames > 0) {
-                SDL_RenderCopyEx(rndr, elem.sprites[frame % count_frames], 
-                        nullptr, &rect, 0.0, nullptr, mirror_flip); 
-                subframe++;
-                if (subframe % sprite_frame_dur == 0) {
-                    frame = frame + 1 % count_frames; 
-                    subframe = 0;
+    while (sim_running.load(std::memory_order_acquire)) {
+        {
+            PROFILE_ZONE("sim_tick");
+            Input_event input;
+            while (input_queue.pop(input)) {
+                const bool pressed = input.type == MoveType::move;
+                const u32 depth = level->depth;
+                if (input.key == SDLK_e && pressed) {
+                    carve_at_player(*level->map, systems);
+                } else if (input.key == SDLK_F5 && pressed) {
+                    write_snapshot(snapshot_source(), snapshot_bytes);
+                    writer.save(quicksave_filename, snapshot_bytes);
+                } else if (input.key == SDLK_F9 && pressed) {
+                    Snapshot_view snap;
+                    if (!read_snapshot_file(quicksave_filename, loaded_bytes)
+                            || !snap.open(loaded_bytes.data(), loaded_bytes.size())) {
+                        LOG_ERR("No usable quicksave in {}", quicksave_filename);
+                    } else {
+                        if (snap.depth != depth) {
+                            level = &switch_level(store, *level, snap.depth);
+                        }
+                        // derived state of another level is rebuilt right after
+                        load_snapshot(snap, *level->map, systems);
+                        rewind.clear();
+                    }
+                } else if (input.key == SDLK_r) {
+                    if (pressed && !rewinding) {
+                        LOG("Rewinding, {} ticks ({:.1f} s) held in {} KiB", rewind.steps(),
+                                rewind.steps() * sim_tick_ms / 1000.f, rewind.bytes() / 1024);
+                    }
+                    rewinding = pressed;
+                } else if (input.key == SDLK_n && pressed && on_tile(*level->map, level->down_stairs)) {
+                    level = &switch_level(store, *level, depth + 1);
+                } else if (input.key == SDLK_b && pressed && depth > 0
+                        && on_tile(*level->map, level->up_stairs)) {
+                    level = &switch_level(store, *level, depth - 1);
+                } else {
+                    handle_input(input);
+                }
+                if (level->depth != depth) {
+                    // new map: derived state starts over and every chunk is re-sent
+                    systems = Map_systems(*level->map);
+                    // snapshots only cover the current level
+                    rewind.clear();
+                    level->map->take_dirty_chunks();
+                    pending_chunks.clear();
+                    for (u16 y = 0; y < level->map->chunks_y(); y++) {
+                        for (u16 x = 0; x < level->map->chunks_x(); x++) {
+                            pending_chunks.push_back(Vec2u{x, y});
+                        }
+                    }
                 }
             }
+            Map& map = *level->map;
+            Snapshot_view snap;
+            if (!rewinding) {
+                simulate_entities(map);
+            } else if (rewind.step_back() && snap.open(rewind.latest().data(), rewind.latest().size())) {
+                load_snapshot(snap, map, systems);
+            }
+            if (!player_entities.empty()) {
+                const auto tile = map.tile_of(physics_comps.at(player_entities.front()).pos);
+                if (!(tile == systems.player_tile)) {
+                    systems.player_tile = tile;
+                    systems.player_flow.set_target(tile);
+                }
+                systems.player_fov.update(map, tile, player_view_radius);
+                systems.lights.sources = {{tile, player_light_radius, 255}};
+            }
+            systems.lights.update(map);
+            if (!rewinding) {
+                advance_animations(animations, sim_tick_ms);
+                write_snapshot(snapshot_source(), snapshot_bytes);
+                rewind.push(snapshot_bytes);
+            }
+            publish_snapshot(tick++, systems.player_fov, systems.lights);
+
+            auto dirty = map.take_dirty_chunks();
+            vec_append(pending_chunks, dirty);
+            size_t sent = 0;
+            while (sent < pending_chunks.size()
+                    && chunk_queue.push(map.read_chunk(pending_chunks[sent]))) {
+                sent++;
+            }
+            pending_chunks.erase(pending_chunks.begin(), pending_chunks.begin() + sent);
+        }
+
+        next_tick += tick_dur;
+        const auto now = Clock::now();
+        if (now > next_tick + sim_max_lag * tick_dur) {
+            // too far behind (debugger, suspended window), drop the backlog
+            next_tick = now;
+        }
+        std::this_thread::sleep_until(next_tick);
+    }
+}
+
+void draw_snapshot(SDL_Renderer* rndr, const Render_snapshot& snap) {
+    PROFILE_ZONE("render_entities");
+    for (const auto& inst : snap.sprites) {
+        auto rend = render_comps.find(inst.id);
+        if (rend != render_comps.end()) {
+            draw_renderable(rndr, rend->second, inst, CONF.width, CONF.height);
         }
     }
 }
 
 int main(int argc, char* argv[]) {
     STATE = init;
+    PROFILE_THREAD("main");
 
-    u64 prev_tick = SDL_GetTicks64();
-    u64 curr_tick = prev_tick;
-    u64 delta_time;
+    u64 curr_tick;
     u64 prev_frame = SDL_GetTicks64();
     u64 delta_frame;
 
@@ -156,18 +560,26 @@ int main(int argc, char* argv[]) {
     }
     // -----------------------------------
 
-    // map generation
-    Vec2u dim = {32, 24};
-    Vec2u spawn = dim / Vec2u{2, 2};
-
-    Map map(dim, spawn);
+    // map generation, the first level is generated on the store's worker
+    run_seed = std::random_device{}();
+    LOG("Run seed {}", run_seed);
+    Level_store levels(level_memory_budget, generate_level);
+    // main thread's copy of the tiles, kept in sync through chunk_queue
+    Map view_map(level_dim, levels.enter(0).map->tiles);
+    Particle_system particles(max_particles);
+    particles.set_map(view_map);
 
     // DEBUG TESTING
     // -----------------------------------
     // player entity init
+    player_walk_clip = animations.add_clip({
+        .first = 0,
+        .count = 2,
+        .frame_ms = (float)sprite_frame_dur,
+    });
     spawn_player({
-            Position::MAX * spawn.x / (float)dim.x,
-            Position::MAX * spawn.y / (float)dim.y,
+            Position::MAX * level_spawn.x / (float)level_dim.x,
+            Position::MAX * level_spawn.y / (float)level_dim.y,
     });
 
     // player sprite init 
@@ -206,50 +618,80 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
     // map texture generation
-	{
-        int tex_w, tex_h;
-        SDL_QueryTexture(brick_wall_tex, nullptr, nullptr, &tex_w, &tex_h);
-        float cell_width = CONF.width / (float)map.width;
-        float cell_height = CONF.height / (float)map.height;
-
-        SDL_Rect dst_rect = {0, 0, (int)(cell_width), (int)cell_height};
-
-        SDL_SetRenderTarget(renderer, map_texture);
-        SDL_RenderClear(renderer);
-        for (size_t y = 0; y < map.height; ++y) {
-            for (size_t x = 0; x < map.width; ++x) {
-                dst_rect.x = x * cell_width;
-                dst_rect.y = y * cell_height;
-
-                // Draw wall or empty space based on the map
-                SDL_Texture* texture;
-                auto tile = map.at(Vec2u{x, y});
-                if (tile == Tile::Wall) {
-                    texture = brick_wall_tex;
-                } else {
-                    texture = brick_bg_tex;
-                }
-                SDL_RenderCopy(renderer, texture, nullptr, &dst_rect);
-            }
-        }
-        SDL_SetRenderTarget(renderer, nullptr);
-    }
+    bake_map_texture(renderer, map_texture, view_map, brick_wall_tex, brick_bg_tex, 
+            CONF.width, CONF.height);
     defer {
         SDL_DestroyTexture(map_texture);
     };
     SDL_RenderCopy(renderer, map_texture, NULL, NULL);
 
+    // the simulation owns entities and components from here on
+    sim_running = true;
+    std::thread sim_thread(simulation_loop, std::ref(levels));
+    defer {
+        sim_running = false;
+        sim_thread.join();
+    };
+
+    Frame_arena frame_arena(frame_arena_size);
+    u64 particle_tick = SDL_GetTicks64();
+    Alloc_stats frame_peak;
+    u64 frames = 0;
     while (STATE != GameState::stopping) {
+        frame_arena.reset();
+        const auto& last = frame_arena.last_frame();
+        frame_peak.allocations = std::max(frame_peak.allocations, last.allocations);
+        frame_peak.bytes = std::max(frame_peak.bytes, last.bytes);
+        frame_peak.overflows += last.overflows;
+        if (++frames % alloc_report_frames == 0) {
+            LOG("Frame arena: at most {} allocations, {} KiB per frame, {} overflows, "
+                    "process peak RSS {} MiB", frame_peak.allocations, frame_peak.bytes / 1024,
+                    frame_peak.overflows, peak_rss_bytes() / (1024 * 1024));
+            frame_peak = {};
+        }
         poll_events(event);
+        snapshots.update();
+
+        // re-bake only what the simulation edited
+        Map_chunk chunk;
+        while (chunk_queue.pop(chunk)) {
+            view_map.write_chunk(chunk);
+        }
+        for (const auto& dirty : view_map.take_dirty_chunks()) {
+            PROFILE_ZONE("bake_map_chunk");
+            bake_map_chunk(renderer, map_texture, view_map, dirty, brick_wall_tex, brick_bg_tex,
+                    CONF.width, CONF.height);
+            particles.update_chunk(view_map, dirty);
+        }
+
+        Particle_burst burst;
+        while (particle_queue.pop(burst)) {
+            particles.spawn(burst);
+        }
+        const u64 now = SDL_GetTicks64();
+        particles.update(std::min((float)(now - particle_tick), particle_max_step_ms));
+        particle_tick = now;
 
         // render
         SDL_RenderClear(renderer);
         SDL_RenderCopy(renderer, map_texture, nullptr, nullptr);
-        handle_entities(window, renderer, map);
-        SDL_RenderPresent(renderer);
+        const auto& snap = snapshots.read_buffer();
+        {
+            PROFILE_ZONE("draw_particles");
+            draw_particles(renderer, particles, CONF.width, CONF.height);
+        }
+        {
+            PROFILE_ZONE("draw_lighting");
+            draw_lighting(renderer, snap.visible, snap.light, CONF.width, CONF.height,
+                    &frame_arena);
+        }
+        draw_snapshot(renderer, snap);
+        {
+            PROFILE_ZONE("SDL_RenderPresent");
+            SDL_RenderPresent(renderer);
+        }
 
         curr_tick = SDL_GetTicks64();
-        delta_time = curr_tick - prev_tick;
 
         // rendering synchro
         delta_frame = curr_tick - prev_frame;
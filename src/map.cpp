@@ -1,8 +1,8 @@
 #include "map.hpp"
+#include "map_impl.hpp"
+#include "profiler.hpp"
+#include <algorithm>
 #include <cassert>
-#include <unordered_set>
-
-constexpr u16 NEIGHBR_NUM = 8;
 
 enum Rotation: byte {
     ROTATION_0 = 0,
@@ -23,9 +23,6 @@ enum Rotation: byte {
  */
 
 // indice ordering for each rotation state
-using N_indices = Arr<u8, NEIGHBR_NUM>;
-using N_kernel 	= Arr<Tile, NEIGHBR_NUM>;
-
 constexpr Arr<N_indices, ROTATION_MAX> ROTATION_LOOKUP_INDICES {
 	// 0   deg:
 	N_indices{0,1,2,3,4,5,6,7},
@@ -102,37 +99,6 @@ constexpr Arr<WFC_pattern, 4> CANDIDATE_PRESETS = {{
 	},
 }};
 
-// neighbour 
-struct Tile_entry {
-	Tile 		tile;
-	float 		entropy = NAN;
-	u32 		total_weight;
-	Arr<float, TILE_MAX> weights;
-};
-
-struct Map_impl {
-    const u32 width;
-    const u32 height;
-    Vec<Tile> data;
-
-	u32 get_idx(u16 x, u16 y) {
-		return width * y + x;
-	};
-
-	u32 get_idx_vec2u(const Vec2u vec2) {
-		return get_idx(vec2.x, vec2.y);
-	};
-
-	std::unordered_set<Vec2u, Vec2u> next_tainted_cells;
-
-    Tile at(Vec2u pos) const;
-
-    Map_impl(Vec2u dimensions, Vec2u starting_pos);
-	N_kernel get_neighbour_kernel(Vec2u pos, Vec<Tile_entry>& tiles);
-	void calc_weights(Tile_entry& cell, N_kernel& kernel);
-	void calc_cell_info(Vec2u pos, Vec<Tile_entry>& tiles);
-};
-
 // TODO: Refactor using a different way of storing rotation data
 void Map_impl::calc_weights(Tile_entry& cell, N_kernel& kernel) {
 	if (cell.tile != Tile::Unknown) {
@@ -166,7 +132,7 @@ void Map_impl::calc_weights(Tile_entry& cell, N_kernel& kernel) {
 	}
 };
 
-N_kernel Map_impl::get_neighbour_kernel(Vec2u pos, Vec<Tile_entry>& tiles) {
+N_kernel Map_impl::get_neighbour_kernel(Vec2u pos) {
 	N_kernel kernel;
 	u16 i = 0;
 	// add neighbouring cells to the set of tainted cells (positions of the cells)
@@ -182,26 +148,26 @@ N_kernel Map_impl::get_neighbour_kernel(Vec2u pos, Vec<Tile_entry>& tiles) {
 				kernel[i] = Tile::Wall;
 				continue;
 			}
-			auto& n_tile = tiles.at(get_idx(n_pos.x, n_pos.y)).tile;
+			auto& n_tile = cells.at(get_idx(n_pos.x, n_pos.y)).tile;
 			kernel[i] = n_tile;
 			if (n_tile == Tile::Unknown) {
 				// LOG_DBG(" 	Tainted at: {}, {}", pos.x + w, pos.y + h);
-				next_tainted_cells.insert(n_pos);
+				taint(n_pos);
 			}
 		}	
 	}
 	return kernel;
 }
 
-void Map_impl::calc_cell_info(Vec2u pos, Vec<Tile_entry>& tiles) {
-	auto& cell = tiles.at(get_idx_vec2u(pos));
-	N_kernel kernel = get_neighbour_kernel(pos, tiles);
+void Map_impl::calc_cell_info(Vec2u pos) {
+	auto& cell = cells.at(get_idx_vec2u(pos));
+	N_kernel kernel = get_neighbour_kernel(pos);
 	calc_weights(cell, kernel);
 	// calc entropy for the weights
 	float entropy = 0.f;
 	for (const auto& weight : cell.weights) {
 		if (weight == 0) continue;
-		const auto probability = weight / cell.total_weight;
+		const auto probability = (float)weight / cell.total_weight;
 		entropy -= probability * log2(probability);
 		/* LOG_DBG("prob: {}, log: {}, total: {}, entropy: {}", 
 				probability, log2(probability), cell.total_weight, cell.entropy); */
@@ -210,46 +176,98 @@ void Map_impl::calc_cell_info(Vec2u pos, Vec<Tile_entry>& tiles) {
 	//LOG_DBG("Updated cell at: {}, {}; with entropy {}", pos.x, pos.y, cell.entropy);
 };
 
-Map_impl::Map_impl(Vec2u dim, Vec2u start_pos): height(dim.x), width(dim.y) {
-	this->data.resize(width * height);
-	Vec<Tile_entry> tiles(width * height);
-	srand(time(NULL));
-
-	for (u16 w = 0; w < width; w++) {
-		for (u16 h = 0; h < height; h++) {
-			// Wall boundary around the map
-			if (w == 0 or w == (width - 1) 
-					or h == 0 or h == (height -1)) {
-				tiles.at(get_idx(w, h)).tile = Tile::Wall;
+Map_impl::Map_impl(Vec2u dim, Vec2u start_pos, u32 seed): width(dim.x), height(dim.y) {
+	PROFILE_ZONE("wfc_generate");
+	this->cells.resize(width * height);
+	this->tainted_flags.resize(width * height);
+	rng.seed(seed != 0 ? seed : time(NULL));
+
+	{
+		PROFILE_ZONE("wfc_init");
+		for (u16 w = 0; w < width; w++) {
+			for (u16 h = 0; h < height; h++) {
+				// Wall boundary around the map
+				if (w == 0 or w == (width - 1) 
+						or h == 0 or h == (height -1)) {
+					cells.at(get_idx(w, h)).tile = Tile::Wall;
+				}
+				// Otherwise unknown
+				else {
+					cells.at(get_idx(w, h)).tile = Tile::Unknown;
+				}
 			}
-			// Otherwise unknown
-			else {
-				tiles.at(get_idx(w, h)).tile = Tile::Unknown;
+		}
+
+		// spawn
+		cells.at(get_idx(start_pos.x, start_pos.y)).tile = Tile::Empty;
+
+		// get neighbouring cells' positions
+		get_neighbour_kernel(start_pos);
+	}
+
+	solve(Vec2u{0, 0}, Vec2u{width - 1, height - 1});
+
+	// output the result
+	PROFILE_ZONE("wfc_output");
+	if (log_enabled(Log_level::debug)) {
+		fmt::memory_buffer row;
+		for (u32 y = 0; y < height; y++) {
+			row.clear();
+			for (u32 x = 0; x < width; x++) {
+				fmt::format_to(std::back_inserter(row), "{}", (u32)cells[get_idx(x, y)].tile);
 			}
+			LOG_DBG("{}", fmt::string_view(row.data(), row.size()));
 		}
 	}
+	LOG_DBG("SPAWN : {}", (u32)cells[get_idx_vec2u(start_pos)].tile);
+	LOG_DBG("SPAWN POS: {} {}", 100.f * start_pos.x / (float)width, 100.f * start_pos.y / (float)height);
+}
+
+Map_impl::Map_impl(Vec2u dim, const Vec<Tile>& tiles): width(dim.x), height(dim.y) {
+	this->cells.resize(width * height);
+	this->tainted_flags.resize(width * height);
+	rng.seed(time(NULL));
+	for (u32 i = 0; i < cells.size(); i++) {
+		cells[i].tile = tiles[i];
+	}
+}
 
-	// spawn
-	tiles.at(get_idx(start_pos.x, start_pos.y)).tile = Tile::Empty;
+void Map_impl::clear_tainted() {
+	for (const auto& pos : next_tainted_cells) {
+		tainted_flags[get_idx_vec2u(pos)] = false;
+	}
+	next_tainted_cells.clear();
+}
 
-	// get neighbouring cells' positions
-	get_neighbour_kernel(start_pos, tiles);
+void Map_impl::write_tiles(Vec<Tile>& tiles) const {
+	tiles.resize(cells.size());
+	for (u32 i = 0; i < cells.size(); i++) {
+		tiles[i] = cells[i].tile;
+	}
+}
 
+void Map_impl::solve(Vec2u min, Vec2u max) {
 	auto calc_tainted_cells = [&]() {
-		auto tainted_cells(std::move(next_tainted_cells));
+		PROFILE_ZONE("wfc_propagate");
+		// both lists keep their capacity, nothing is allocated per step
+		tainted_cells.swap(next_tainted_cells);
 		next_tainted_cells.clear();
 		for (const auto& cell_pos : tainted_cells) {
-			calc_cell_info(cell_pos, tiles);
+			tainted_flags[get_idx_vec2u(cell_pos)] = false;
+		}
+		for (const auto& cell_pos : tainted_cells) {
+			calc_cell_info(cell_pos);
 		}
 	};
 
 	Vec2u current_pos;
 	auto setup_lowest_entropy = [&]() -> bool {
 		calc_tainted_cells();
+		PROFILE_ZONE("wfc_lowest_entropy");
 		float lowest_entropy = FLT_MAX;
-		for (u32 y = 0; y < height; y++) {
-			for (u32 x = 0; x < width; x++) {
-				const auto& cell = tiles.at(get_idx(x, y));
+		for (u32 y = min.y; y <= max.y; y++) {
+			for (u32 x = min.x; x <= max.x; x++) {
+				const auto& cell = cells.at(get_idx(x, y));
 				if (isnan(cell.entropy)) { 
 					continue;
 				}
@@ -267,18 +285,24 @@ Map_impl::Map_impl(Vec2u dim, Vec2u start_pos): height(dim.x), width(dim.y) {
 		return lowest_entropy != FLT_MAX;
 	};
 
-	u32 iter = 0;
     while (setup_lowest_entropy()) {
-    	auto& cell = tiles.at(get_idx_vec2u(current_pos));
+		PROFILE_ZONE("wfc_collapse");
+    	auto& cell = cells.at(get_idx_vec2u(current_pos));
 		/* LOG_DBG("TILE AT POS: {}, {}", current_pos.x, current_pos.y);
 		LOG_DBG(" 	entropy: {}, total_weight: {}", cell.entropy, cell.total_weight); */
 		if (cell.tile != Tile::Unknown) {
 			LOG_ERR("ILLEGAL STATE DETECTED!");
+			log_flush();
 			assert(false);
 		}
+		if (cell.total_weight == 0) {
+			// no pattern fits the surroundings
+			cell.tile = Tile::Wall;
+			continue;
+		}
 
 		// set the tile
-		int choice = rand() % cell.total_weight;
+		int choice = rng() % cell.total_weight;
 		for (i32 i = 0; i < cell.weights.size(); i++) {
 			choice -= cell.weights[i];
 			if (choice > 0) {
@@ -289,20 +313,44 @@ Map_impl::Map_impl(Vec2u dim, Vec2u start_pos): height(dim.x), width(dim.y) {
 			break;
 		}
 		// LOG_DBG(" 	 	HAS CHOSEN: {}", (u32)cell.tile);
-		iter++;
     }
+}
 
-	// output the result
-	for (u16 i = 0; i < height * width; i++) {
-		this->data[i] = tiles[i].tile;
-		if (i % (width) == 0) {
-			printf("\n");
+void Map_impl::resolve_region(Vec2u center, Tile tile, Vec2u min, Vec2u max) {
+	PROFILE_ZONE("wfc_resolve_region");
+	clear_tainted();
+	for (u32 y = min.y; y <= max.y; y++) {
+		for (u32 x = min.x; x <= max.x; x++) {
+			cells[get_idx(x, y)] = Tile_entry{};
 		}
-		u32 sym = tiles.at(i).tile;
-		printf("%lu ", sym);
 	}
-	LOG_DBG("SPAWN : {}", (u32)data[get_idx_vec2u(start_pos)]);
-	LOG_DBG("SPAWN POS: {} {}", 100.f * start_pos.x / (float)width, 100.f * start_pos.y / (float)height);
+	cells[get_idx_vec2u(center)].tile = tile;
+
+	// like at generation, only cells touching a decided one start tainted
+	for (u32 y = min.y; y <= max.y; y++) {
+		for (u32 x = min.x; x <= max.x; x++) {
+			if (cells[get_idx(x, y)].tile != Tile::Unknown) {
+				continue;
+			}
+			bool touches_known = false;
+			for (i32 h = -1; h <= 1 && !touches_known; h++) {
+				for (i32 w = -1; w <= 1; w++) {
+					const i32 n_x = x + w;
+					const i32 n_y = y + h;
+					if (n_x < 0 || n_y < 0 || n_x >= (i32)width || n_y >= (i32)height
+							|| cells[get_idx(n_x, n_y)].tile != Tile::Unknown) {
+						touches_known = true;
+						break;
+					}
+				}
+			}
+			if (touches_known) {
+				taint(Vec2u{x, y});
+			}
+		}
+	}
+
+	solve(min, max);
 }
 
 Tile Map_impl::at(Vec2u pos) const {
@@ -310,14 +358,124 @@ Tile Map_impl::at(Vec2u pos) const {
 		|| pos.y <= 0 || pos.y >= height) {
 		return Tile::Wall;
 	} else {
-		return data[pos.x + (width * pos.y)];
+		return cells[pos.x + (width * pos.y)].tile;
 	}
 }
 
 // TODO: Refactor
-Map::Map(Vec2u dim, Vec2u spawn_pos): width(dim.x), height(dim.y) {
-	auto impl = Map_impl(dim, spawn_pos);
-	this->tiles = impl.data;
+Map::Map(Vec2u dim, Vec2u spawn_pos, bool keep_solver, u32 seed): width(dim.x), height(dim.y) {
+	auto impl = std::make_unique<Map_impl>(dim, spawn_pos, seed);
+	impl->write_tiles(this->tiles);
+	this->generation_stats = impl->arena.stats();
+	this->dirty_chunks.resize(chunks_x() * chunks_y());
+	if (keep_solver) {
+		this->solver = std::move(impl);
+	}
+}
+
+Map::Map(Vec2u dim, Vec<Tile> map_tiles, bool keep_solver)
+		: width(dim.x), height(dim.y), tiles(std::move(map_tiles)) {
+	assert(tiles.size() == (size_t)width * height);
+	this->dirty_chunks.resize(chunks_x() * chunks_y());
+	if (keep_solver) {
+		this->solver = std::make_unique<Map_impl>(dim, tiles);
+	}
+}
+
+Map::~Map() = default;
+
+void Map::set(Vec2u pos, Tile tile) {
+	tiles[pos.x + width * pos.y] = tile;
+	dirty_chunks[pos.x / CHUNK_SIZE + chunks_x() * (pos.y / CHUNK_SIZE)] = true;
+}
+
+Vec<Vec2u> Map::edit(Vec2u pos, Tile tile, u16 radius) {
+	Vec<Vec2u> changed;
+	// the outer wall stays
+	if (pos.x == 0 || pos.y == 0 || pos.x >= width - 1 || pos.y >= height - 1) {
+		return changed;
+	}
+	if (solver == nullptr || radius == 0) {
+		if (solver != nullptr) {
+			solver->cells[pos.x + width * pos.y] = Tile_entry{.tile = tile};
+		}
+		if (at(pos) != tile) {
+			set(pos, tile);
+			changed.push_back(pos);
+		}
+		return changed;
+	}
+	const Vec2u min {
+		.x = pos.x > radius + 1u ? pos.x - radius : 1u,
+		.y = pos.y > radius + 1u ? pos.y - radius : 1u
+	};
+	const Vec2u max {
+		.x = std::min<u16>(pos.x + radius, width - 2),
+		.y = std::min<u16>(pos.y + radius, height - 2)
+	};
+	solver->resolve_region(pos, tile, min, max);
+	for (u16 y = min.y; y <= max.y; y++) {
+		for (u16 x = min.x; x <= max.x; x++) {
+			const Tile solved = solver->cells[x + width * y].tile;
+			if (tiles[x + width * y] != solved) {
+				set(Vec2u{x, y}, solved);
+				changed.push_back(Vec2u{x, y});
+			}
+		}
+	}
+	return changed;
+}
+
+size_t Map::resident_bytes() const {
+	size_t bytes = sizeof(Map) + tiles.capacity() * sizeof(Tile) + dirty_chunks.capacity();
+	if (solver != nullptr) {
+		bytes += sizeof(Map_impl) + solver->arena.stats().reserved;
+	}
+	return bytes;
+}
+
+Vec<Vec2u> Map::take_dirty_chunks() {
+	Vec<Vec2u> chunks;
+	for (u16 y = 0; y < chunks_y(); y++) {
+		for (u16 x = 0; x < chunks_x(); x++) {
+			auto& dirty = dirty_chunks[x + chunks_x() * y];
+			if (dirty) {
+				chunks.push_back(Vec2u{x, y});
+				dirty = false;
+			}
+		}
+	}
+	return chunks;
+}
+
+Map_chunk Map::read_chunk(Vec2u chunk) const {
+	Map_chunk out {.chunk = chunk};
+	out.tiles.fill(Tile::Wall);
+	for (u16 y = 0; y < CHUNK_SIZE; y++) {
+		for (u16 x = 0; x < CHUNK_SIZE; x++) {
+			const u32 t_x = chunk.x * CHUNK_SIZE + x;
+			const u32 t_y = chunk.y * CHUNK_SIZE + y;
+			if (t_x < width && t_y < height) {
+				out.tiles[x + CHUNK_SIZE * y] = tiles[t_x + width * t_y];
+			}
+		}
+	}
+	return out;
+}
+
+void Map::write_chunk(const Map_chunk& in) {
+	for (u16 y = 0; y < CHUNK_SIZE; y++) {
+		for (u16 x = 0; x < CHUNK_SIZE; x++) {
+			const u16 t_x = in.chunk.x * CHUNK_SIZE + x;
+			const u16 t_y = in.chunk.y * CHUNK_SIZE + y;
+			if (t_x < width && t_y < height) {
+				tiles[t_x + width * t_y] = in.tiles[x + CHUNK_SIZE * y];
+			}
+		}
+	}
+	if (in.chunk.x < chunks_x() && in.chunk.y < chunks_y()) {
+		dirty_chunks[in.chunk.x + chunks_x() * in.chunk.y] = true;
+	}
 }
 
 Tile Map::at_pos(Position pos) const {
@@ -328,6 +486,24 @@ Tile Map::at_pos(Position pos) const {
 	return this->at(n_pos);
 }
 
+Vec2u Map::tile_of(Position pos) const {
+	auto to_tile = [](float coord, u16 size) -> u16 {
+		const i32 tile = coord / Position::MAX * size;
+		return tile < 0 ? 0 : (tile >= (i32)size ? size - 1 : tile);
+	};
+	return Vec2u {
+		.x = to_tile(pos.x, width),
+		.y = to_tile(Position::MAX - pos.y, height)
+	};
+}
+
+Position Map::position_of(Vec2u tile) const {
+	return Position {
+		.x = Position::MAX * (tile.x + 0.5f) / width,
+		.y = Position::MAX - Position::MAX * (tile.y + 0.5f) / height
+	};
+}
+
 Tile Map::at(Vec2u pos) const {
 	if (pos.x <= 0 || pos.x >= width 
 		|| pos.y <= 0 || pos.y >= height) {
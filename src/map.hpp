@@ -2,7 +2,9 @@
 #define RGL_MAP_HPP
 
 #include "types_utils.hpp"
+#include "alloc.hpp"
 #include <SDL2/SDL_render.h>
+#include <memory>
 
 enum Tile: char {
     Empty = 0,
@@ -19,13 +21,57 @@ struct Position {
     static constexpr float MAX = 100.f;
 };
 
+struct Map_impl;
+struct Map_chunk;
+
 struct Map {
+    // tiles per side of a render chunk
+    static constexpr u16 CHUNK_SIZE = 8;
+
     const u16 width, height;
     Vec<Tile> tiles;
-    Map(Vec2u dimensions, Vec2u spawn_pos);
+    // WFC solver state, only kept when asked for so the map can be edited
+    Uq_ptr<Map_impl> solver;
+    // one flag per chunk, set whenever a tile in it changes
+    Vec<byte> dirty_chunks;
+    // solver arena use while generating, left empty for wrapped tiles;
+    // reporting it is up to the caller
+    Alloc_stats generation_stats;
+
+    // the same seed gives the same map, 0 picks one from the clock
+    Map(Vec2u dimensions, Vec2u spawn_pos, bool keep_solver = false, u32 seed = 0);
+    // wraps already generated tiles, the solver is rebuilt from them if asked
+    Map(Vec2u dimensions, Vec<Tile> tiles, bool keep_solver = false);
+    ~Map();
 
     Tile at(Vec2u tile_pos) const;
     Tile at_pos(Position pos) const;
+    // tile under a world position, tile rows grow downwards like on screen
+    Vec2u tile_of(Position pos) const;
+    // centre of a tile, the inverse of tile_of()
+    Position position_of(Vec2u tile) const;
+
+    void set(Vec2u tile_pos, Tile tile);
+    // Sets a tile and, with the solver kept, re-solves every other tile 
+    // within `radius` under the same WFC patterns. Cost depends on the
+    // radius only. Returns the tiles that changed.
+    Vec<Vec2u> edit(Vec2u tile_pos, Tile tile, u16 radius);
+
+    // heap and inline bytes held, solver included
+    size_t resident_bytes() const;
+
+    u16 chunks_x() const { return (width + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+    u16 chunks_y() const { return (height + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+    // returns the dirty chunk coordinates and clears their flags
+    Vec<Vec2u> take_dirty_chunks();
+    Map_chunk read_chunk(Vec2u chunk) const;
+    void write_chunk(const Map_chunk& chunk);
+};
+
+// copy of one render chunk, tiles outside the map read as walls
+struct Map_chunk {
+    Vec2u chunk;
+    Arr<Tile, Map::CHUNK_SIZE * Map::CHUNK_SIZE> tiles;
 };
 
 #endif // RGL_MAP_HPP
@@ -0,0 +1,75 @@
+#ifndef RGL_MAP_IMPL_HPP
+#define RGL_MAP_IMPL_HPP
+
+// WFC solver internals, shared by map.cpp and the benchmarks
+
+#include "types_utils.hpp"
+#include "map.hpp"
+#include "alloc.hpp"
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+constexpr u16 NEIGHBR_NUM = 8;
+
+using N_indices = Arr<u8, NEIGHBR_NUM>;
+using N_kernel 	= Arr<Tile, NEIGHBR_NUM>;
+
+// per-cell solver state, kept compact since Map can hold on to it
+struct Tile_entry {
+	Tile 		tile = Tile::Unknown;
+	uint32_t 	total_weight = 0;
+	float 		entropy = NAN;
+	// weights pile up over recalculations, 16 bits wrap and skew the map
+	Arr<uint32_t, TILE_MAX> weights = {};
+};
+
+// Every container lives in the solver's arena: generation allocates a
+// handful of times and the lot is released with the solver.
+struct Map_impl {
+    const u32 width;
+    const u32 height;
+    Arena arena;
+    Pmr_vec<Tile_entry> cells{&arena};
+    std::minstd_rand rng;
+
+	u32 get_idx(u16 x, u16 y) {
+		return width * y + x;
+	};
+
+	u32 get_idx_vec2u(const Vec2u vec2) {
+		return get_idx(vec2.x, vec2.y);
+	};
+
+	// cells to recalculate before the next collapse, flagged to skip duplicates
+	Pmr_vec<Vec2u> next_tainted_cells{&arena};
+	Pmr_vec<Vec2u> tainted_cells{&arena};
+	Pmr_vec<byte>  tainted_flags{&arena};
+
+	void taint(Vec2u pos) {
+		auto& flag = tainted_flags[get_idx_vec2u(pos)];
+		if (!flag) {
+			flag = true;
+			next_tainted_cells.push_back(pos);
+		}
+	}
+	void clear_tainted();
+
+    Tile at(Vec2u pos) const;
+	// copies the collapsed cells out
+	void write_tiles(Vec<Tile>& tiles) const;
+
+	// seed 0 picks one from the clock
+    Map_impl(Vec2u dimensions, Vec2u starting_pos, u32 seed = 0);
+	// solver state for an already generated map, every cell collapsed
+    Map_impl(Vec2u dimensions, const Vec<Tile>& tiles);
+	N_kernel get_neighbour_kernel(Vec2u pos);
+	void calc_weights(Tile_entry& cell, N_kernel& kernel);
+	void calc_cell_info(Vec2u pos);
+	// collapses every unknown cell within [min, max]
+	void solve(Vec2u min, Vec2u max);
+	// re-opens [min, max] with `center` fixed to `tile` and solves it again
+	void resolve_region(Vec2u center, Tile tile, Vec2u min, Vec2u max);
+};
+
+#endif // RGL_MAP_IMPL_HPP
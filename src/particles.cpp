@@ -0,0 +1,246 @@
+#include "particles.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+struct Particle_params {
+    // launch speed in units per second, spread in radians either side of up
+    float speed_min, speed_max;
+    float spread;
+    // share of the burst's velocity passed on
+    float inherit;
+    float gravity;
+    // ms
+    float life_min, life_max;
+    // quad side in pixels
+    float size;
+    // alpha comes from the remaining life
+    SDL_Color color;
+};
+
+constexpr Arr<Particle_params, PARTICLE_KIND_MAX> PARTICLE_PARAMS {{
+    // dust kicked up sideways, drifts and settles
+    {8.f, 25.f, 1.4f, 0.3f, 20.f, 250.f, 600.f, 2.f, {170, 160, 140, 0}},
+    // sparks fly anywhere and fall fast
+    {40.f, 90.f, 3.1f, 0.f, 120.f, 150.f, 350.f, 2.f, {255, 200, 80, 0}},
+    // debris is thrown up and tumbles back down
+    {20.f, 50.f, 0.8f, 0.5f, 200.f, 600.f, 1200.f, 3.f, {110, 80, 50, 0}},
+}};
+
+// velocity kept along the axis of a bounce, and across it on a floor hit
+constexpr float bounce = 0.4f;
+constexpr float friction = 0.6f;
+// units per second below which a particle counts as resting
+constexpr float rest_speed = 0.01f;
+// particles fade out over their last ms
+constexpr float fade_ms = 250.f;
+
+Particle_system::Particle_system(u32 capacity, u32 seed)
+    : vertex_xy(capacity * 8), vertex_colors(capacity * 4), indices(capacity * 6), max_count(capacity), rng(seed),
+      pos_x(capacity), pos_y(capacity), vel_x(capacity), vel_y(capacity),
+      gravity(capacity), life(capacity), kind(capacity),
+      mask_width(1), mask_height(1), solid(1, 0) {
+    // quads never change their corners' order, the index buffer is fixed
+    for (u32 i = 0; i < capacity; i++) {
+        const int base = i * 4;
+        const Arr<int, 6> quad = {base, base + 1, base + 2, base, base + 2, base + 3};
+        std::copy(quad.begin(), quad.end(), indices.begin() + i * 6);
+    }
+}
+
+float Particle_system::random(float min, float max) {
+    return min + (max - min) * (rng() - rng.min()) / (float)(rng.max() - rng.min());
+}
+
+void Particle_system::spawn(const Particle_burst& burst) {
+    const auto& params = PARTICLE_PARAMS[burst.kind];
+    const u32 fits = std::min<u32>(burst.count, max_count - count);
+    dropped_count += burst.count - fits;
+    for (u32 i = count; i < count + fits; i++) {
+        const float angle = std::numbers::pi_v<float> / 2 + random(-params.spread, params.spread);
+        const float speed = random(params.speed_min, params.speed_max);
+        pos_x[i] = burst.pos.x;
+        pos_y[i] = burst.pos.y;
+        vel_x[i] = std::cos(angle) * speed + burst.vel_x * params.inherit;
+        vel_y[i] = std::sin(angle) * speed + burst.vel_y * params.inherit;
+        gravity[i] = params.gravity;
+        life[i] = random(params.life_min, params.life_max);
+        kind[i] = burst.kind;
+    }
+    count += fits;
+}
+
+static bool is_solid(Tile tile) {
+    // same rule as check_collision
+    return tile != Tile::Empty && tile != Tile::Stairs;
+}
+
+void Particle_system::set_map(const Map& map) {
+    mask_width = map.width;
+    mask_height = map.height;
+    solid.resize(map.tiles.size());
+    for (size_t i = 0; i < map.tiles.size(); i++) {
+        solid[i] = is_solid(map.tiles[i]);
+    }
+}
+
+void Particle_system::update_chunk(const Map& map, Vec2u chunk) {
+    if (map.width != mask_width || map.height != mask_height) {
+        set_map(map);
+        return;
+    }
+    const u16 min_x = chunk.x * Map::CHUNK_SIZE;
+    const u16 min_y = chunk.y * Map::CHUNK_SIZE;
+    const u16 max_x = std::min<u16>(min_x + Map::CHUNK_SIZE, map.width);
+    const u16 max_y = std::min<u16>(min_y + Map::CHUNK_SIZE, map.height);
+    for (u16 y = min_y; y < max_y; y++) {
+        for (u16 x = min_x; x < max_x; x++) {
+            solid[x + map.width * y] = is_solid(map.tiles[x + map.width * y]);
+        }
+    }
+}
+
+// particles moved per pass, the per block scratch stays in L1
+constexpr u32 update_block = 256;
+
+void Particle_system::update(float dt_ms) {
+    PROFILE_ZONE("particles_update");
+    const float dt = dt_ms / 1000.f;
+    const float scale_x = mask_width / Position::MAX;
+    const float scale_y = mask_height / Position::MAX;
+    // the last tile's far edge is left out so truncation stays in range
+    const float last_x = mask_width - 0.001f;
+    const float last_y = mask_height - 0.001f;
+    const i32 stride = mask_width;
+
+    float* __restrict px = pos_x.data();
+    float* __restrict py = pos_y.data();
+    float* __restrict vx = vel_x.data();
+    float* __restrict vy = vel_y.data();
+    float* __restrict remaining = life.data();
+    const float* __restrict g = gravity.data();
+    const byte* __restrict tiles = solid.data();
+
+    // Each axis is moved on its own and bounces back if that lands in a
+    // solid tile, a move only blocked diagonally counts as a floor or
+    // ceiling hit. The tile reads are a gather, so they get a scalar pass
+    // of their own and the arithmetic around them stays branch free for
+    // the compiler to vectorize.
+    alignas(64) Arr<i32, update_block> tile_x, tile_y, tile_new_x, tile_new_y;
+    alignas(64) Arr<float, update_block> hit_x, hit_y;
+    for (u32 begin = 0; begin < count; begin += update_block) {
+        const u32 n = std::min(update_block, count - begin);
+        float* __restrict bx = px + begin;
+        float* __restrict by = py + begin;
+        float* __restrict bvx = vx + begin;
+        float* __restrict bvy = vy + begin;
+        float* __restrict blife = remaining + begin;
+        const float* __restrict bg = g + begin;
+
+        // tile rows grow downwards, like Map::tile_of(); clamped as floats
+        // since that's what plain SSE2 has min/max instructions for
+        for (u32 i = 0; i < n; i++) {
+            bvy[i] -= bg[i] * dt;
+            const float old_x = bx[i] * scale_x;
+            const float old_y = (Position::MAX - by[i]) * scale_y;
+            const float new_x = (bx[i] + bvx[i] * dt) * scale_x;
+            const float new_y = (Position::MAX - by[i] - bvy[i] * dt) * scale_y;
+            tile_x[i] = (i32)std::min(std::max(old_x, 0.f), last_x);
+            tile_y[i] = (i32)std::min(std::max(old_y, 0.f), last_y);
+            tile_new_x[i] = (i32)std::min(std::max(new_x, 0.f), last_x);
+            tile_new_y[i] = (i32)std::min(std::max(new_y, 0.f), last_y);
+        }
+        for (u32 i = 0; i < n; i++) {
+            const i32 row = tile_y[i] * stride;
+            const i32 new_row = tile_new_y[i] * stride;
+            // one already inside a wall (spawned there) moves freely to get out
+            const byte free = tiles[tile_x[i] + row] ^ 1;
+            const byte blocked_x = tiles[tile_new_x[i] + row] & free;
+            const byte blocked_y = (tiles[tile_x[i] + new_row]
+                | (tiles[tile_new_x[i] + new_row] & (blocked_x ^ 1))) & free;
+            hit_x[i] = blocked_x;
+            hit_y[i] = blocked_y;
+        }
+        for (u32 i = 0; i < n; i++) {
+            const float speed_x = bvx[i];
+            const float speed_y = bvy[i];
+            const float keep_x = 1.f - hit_x[i];
+            const float keep_y = 1.f - hit_y[i];
+            bx[i] += speed_x * dt * keep_x;
+            by[i] += speed_y * dt * keep_y;
+            // -bounce on a hit, friction along a floor, unchanged otherwise
+            const float along_x = keep_y + hit_y[i] * friction;
+            const float next_x = speed_x * (keep_x * along_x - hit_x[i] * bounce);
+            const float next_y = speed_y * (keep_y - hit_y[i] * bounce);
+            // settled particles stop instead of decaying into denormals
+            bvx[i] = std::fabs(next_x) < rest_speed ? 0.f : next_x;
+            bvy[i] = std::fabs(next_y) < rest_speed ? 0.f : next_y;
+            blife[i] -= dt_ms;
+        }
+    }
+    expire();
+}
+
+void Particle_system::expire() {
+    u32 i = 0;
+    while (i < count) {
+        if (life[i] > 0.f) {
+            i++;
+            continue;
+        }
+        // the last particle takes the slot and is checked next
+        count--;
+        pos_x[i] = pos_x[count];
+        pos_y[i] = pos_y[count];
+        vel_x[i] = vel_x[count];
+        vel_y[i] = vel_y[count];
+        gravity[i] = gravity[count];
+        life[i] = life[count];
+        kind[i] = kind[count];
+    }
+}
+
+void Particle_system::build_geometry(u32 screen_w, u32 screen_h) {
+    PROFILE_ZONE("particles_geometry");
+    const float to_screen_x = screen_w / Position::MAX;
+    const float to_screen_y = screen_h / Position::MAX;
+    // colours are written as packed words: the kind's rgb plus alpha
+    // times the word that has a 1 in the alpha byte
+    auto pack = [](SDL_Color color) {
+        uint32_t word;
+        memcpy(&word, &color, sizeof(word));
+        return word;
+    };
+    const uint32_t alpha_one = pack({0, 0, 0, 1});
+    Arr<float, PARTICLE_KIND_MAX> halves;
+    Arr<uint32_t, PARTICLE_KIND_MAX> rgb;
+    for (u32 k = 0; k < PARTICLE_KIND_MAX; k++) {
+        const auto& color = PARTICLE_PARAMS[k].color;
+        halves[k] = PARTICLE_PARAMS[k].size / 2;
+        rgb[k] = pack(color);
+    }
+    float* __restrict xy = vertex_xy.data();
+    uint32_t* __restrict colors = reinterpret_cast<uint32_t*>(vertex_colors.data());
+    for (u32 i = 0; i < count; i++) {
+        const float half = halves[kind[i]];
+        const float x = pos_x[i] * to_screen_x;
+        const float y = screen_h - pos_y[i] * to_screen_y;
+        float* quad = xy + i * 8;
+        quad[0] = x - half;
+        quad[1] = y - half;
+        quad[2] = x + half;
+        quad[3] = y - half;
+        quad[4] = x + half;
+        quad[5] = y + half;
+        quad[6] = x - half;
+        quad[7] = y + half;
+        const uint32_t alpha = (uint32_t)(std::min(life[i], fade_ms) * (255 / fade_ms));
+        const uint32_t color = rgb[kind[i]] | alpha * alpha_one;
+        colors[i * 4] = color;
+        colors[i * 4 + 1] = color;
+        colors[i * 4 + 2] = color;
+        colors[i * 4 + 3] = color;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef RGL_PARTICLES_HPP
+#define RGL_PARTICLES_HPP
+
+#include "types_utils.hpp"
+#include "map.hpp"
+#include <SDL2/SDL_render.h>
+#include <random>
+
+enum Particle_kind : byte {
+    PARTICLE_DUST,
+    PARTICLE_SPARK,
+    PARTICLE_DEBRIS,
+    PARTICLE_KIND_MAX,
+};
+
+// a request for `count` particles of a kind around `pos`, sent by the
+// simulation when something lands, jumps or runs into a wall
+struct Particle_burst {
+    Position pos;
+    // velocity of whatever caused it, position units per second
+    float vel_x = 0.f;
+    float vel_y = 0.f;
+    u16 count = 0;
+    Particle_kind kind = PARTICLE_DUST;
+};
+
+// Short lived visual particles, not entities. Every attribute is its own
+// array (structure of arrays) so update() streams through plain floats in
+// loops the compiler vectorizes. Storage is allocated once for `capacity`
+// particles, bursts that don't fit are cut short and expired particles are
+// replaced by the last live one.
+// Positions are in world units like Physics, y grows upwards.
+struct Particle_system {
+    explicit Particle_system(u32 capacity, u32 seed = 1);
+
+    void spawn(const Particle_burst& burst);
+    void update(float dt_ms);
+    void clear() { count = 0; }
+
+    // solid tiles particles bounce off, re-read per chunk after edits
+    void set_map(const Map& map);
+    void update_chunk(const Map& map, Vec2u chunk);
+
+    // fills the vertex arrays with a quad per live particle in screen
+    // space, ready for a single SDL_RenderGeometryRaw call
+    void build_geometry(u32 screen_w, u32 screen_h);
+
+    u32 size() const { return count; }
+    u32 capacity() const { return max_count; }
+    // particles asked for that didn't fit
+    u64 dropped() const { return dropped_count; }
+
+    // 4 vertices a particle, positions and colours kept apart since there
+    // are no texture coordinates to interleave
+    Vec<float>     vertex_xy;
+    Vec<SDL_Color> vertex_colors;
+    Vec<int>       indices;
+
+private:
+    const u32 max_count;
+    u32 count = 0;
+    u64 dropped_count = 0;
+    std::minstd_rand rng;
+
+    Vec<float> pos_x, pos_y;
+    Vec<float> vel_x, vel_y;
+    Vec<float> gravity;
+    // remaining ms
+    Vec<float> life;
+    Vec<byte>  kind;
+
+    u16 mask_width = 0, mask_height = 0;
+    // 1 where a particle collides, one byte per tile
+    Vec<byte> solid;
+
+    float random(float min, float max);
+    void expire();
+};
+
+#endif // RGL_PARTICLES_HPP
@@ -3,7 +3,7 @@
 
 constexpr int max_step = 14;
 
-void update_move(Physics &comp, Direction dir, MoveType type) {
+Physics_event update_move(Physics &comp, Direction dir, MoveType type) {
     if (type == MoveType::move) {
         switch (dir) {
             case left:
@@ -19,6 +19,7 @@ void update_move(Physics &comp, Direction dir, MoveType type) {
                     LOG_DBG("JUMPED!");
                     comp.vel.y = comp.accel.y;
                     comp.loc = air;
+                    return EVENT_JUMPED;
                 }
                 break;
             default:
@@ -41,25 +42,10 @@ void update_move(Physics &comp, Direction dir, MoveType type) {
                 break;
         }
     }
+    return EVENT_NONE;
 }
 
-enum Collision_Type {
-    NONE = false,
-    COLLISION
-};
-
-
-// check for collisions between a bytearray and a rectangle
-inline Collision_Type check_collision(const Map& map, const Position &pos)  {
-    // LOG_DBG("Real Position: {}, {}", pos.x, pos.y);
-    const auto tile = map.at_pos(pos);
-    if (tile != Tile::Empty) {
-        return COLLISION;
-    }
-    return NONE;
-}
-
-void update_tick(Physics &comp, const Map &map) {
+Physics_event update_tick(Physics &comp, const Map &map) {
     // Handle movements:
     auto vel   = comp.vel;
     auto accel = comp.accel;
@@ -97,6 +83,7 @@ void update_tick(Physics &comp, const Map &map) {
             comp.vel.y = 0;
             comp.loc = Location::ground;
             LOG_DBG("Landed on the ground!");
+            return EVENT_LANDED;
         } else {
             for (u32 off_y = -max_step; off_y <= max_step; off_y++) {
                 new_pos.y += off_y;
@@ -107,10 +94,13 @@ void update_tick(Physics &comp, const Map &map) {
                     comp.vel = vel;
                     comp.loc = Location::air;
                     LOG_DBG("Flying!");
-                    return;
+                    return EVENT_NONE;
                 }
             }
+            // only the first blocked tick counts, pushing on stays quiet
+            const bool moving = comp.vel.x != 0.f;
             comp.vel.x = 0.f;
+            return moving ? EVENT_HIT_WALL : EVENT_NONE;
         }
     } else {
         comp.vel = vel;
@@ -118,4 +108,5 @@ void update_tick(Physics &comp, const Map &map) {
         comp.pos.y = new_pos.y;
     }
     // LOG_DBG("{} {}, {} {}", pos.x, pos.y, new_pos.x, new_pos.y);
+    return EVENT_NONE;
 }
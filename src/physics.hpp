@@ -38,7 +38,30 @@ struct Physics {
     Location    loc;
 };
 
-void update_move(Physics &component, Direction dir, MoveType type);
-void update_tick(Physics &comp, const Map &map);
+// what a movement update did to a body, for effects to react to
+enum Physics_event : byte {
+    EVENT_NONE,
+    EVENT_JUMPED,
+    EVENT_LANDED,
+    EVENT_HIT_WALL,
+};
+
+enum Collision_Type {
+    NONE = false,
+    COLLISION
+};
+
+// check for collisions between a bytearray and a rectangle
+inline Collision_Type check_collision(const Map& map, const Position &pos)  {
+    // LOG_DBG("Real Position: {}, {}", pos.x, pos.y);
+    const auto tile = map.at_pos(pos);
+    if (tile != Tile::Empty && tile != Tile::Stairs) {
+        return COLLISION;
+    }
+    return NONE;
+}
+
+Physics_event update_move(Physics &component, Direction dir, MoveType type);
+Physics_event update_tick(Physics &comp, const Map &map);
 
 #endif // RGL_PHYSICS_HPP
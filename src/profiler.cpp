@@ -0,0 +1,101 @@
+#include "profiler.hpp"
+
+#ifdef RGL_PROFILE
+
+#include <cstdio>
+#include <mutex>
+
+// buffers are never freed so zones of finished threads can still be exported
+static std::mutex registry_mutex;
+static Vec<Uq_ptr<Zone_buffer>> registry;
+
+// reference point for converting ticks into nanoseconds
+static u64 epoch_ticks = 0;
+static std::chrono::steady_clock::time_point epoch_time;
+
+Zone_buffer* profiler_register_thread() {
+    std::lock_guard lock(registry_mutex);
+    if (registry.empty()) {
+        epoch_ticks = profiler_ticks();
+        epoch_time = std::chrono::steady_clock::now();
+    }
+    auto& buffer = registry.emplace_back(std::make_unique<Zone_buffer>());
+    buffer->thread_id = registry.size();
+    return buffer.get();
+}
+
+void profiler_set_thread_name(const char* name) {
+    if (zone_buffer == nullptr) {
+        zone_buffer = profiler_register_thread();
+    }
+    std::lock_guard lock(registry_mutex);
+    zone_buffer->thread_name = name;
+}
+
+bool profiler_export_chrome_trace(const char* filename) {
+    PROFILE_ZONE("profiler_export");
+    std::FILE* file = std::fopen(filename, "w");
+    if (file == nullptr) {
+        LOG_ERR("Failed to open {} for the trace export", filename);
+        return false;
+    }
+    defer { std::fclose(file); };
+
+    std::lock_guard lock(registry_mutex);
+    const u64 now_ticks = profiler_ticks();
+    const auto now_time = std::chrono::steady_clock::now();
+    const double elapsed_ns = std::chrono::duration<double, std::nano>(now_time - epoch_time).count();
+    const double us_per_tick = now_ticks > epoch_ticks
+        ? elapsed_ns / 1'000.0 / (double)(now_ticks - epoch_ticks) : 0.0;
+    auto to_us = [&](u64 ticks) {
+        return (double)(i64)(ticks - epoch_ticks) * us_per_tick;
+    };
+
+    fmt::print(file, "{{\"traceEvents\":[\n");
+    bool first = true;
+    auto separator = [&]() {
+        const char* sep = first ? "" : ",\n";
+        first = false;
+        return sep;
+    };
+    Vec<Zone_event> events;
+    events.reserve(ZONE_BUFFER_SIZE);
+    for (const auto& buffer : registry) {
+        if (buffer->thread_name != nullptr) {
+            fmt::print(file,
+                "{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                separator(), buffer->thread_id, buffer->thread_name);
+        }
+        // copy first, skipping slots the owning thread rewrote meanwhile
+        const u64 head = buffer->head.load(std::memory_order_acquire);
+        const u64 tail = head > ZONE_BUFFER_SIZE ? head - ZONE_BUFFER_SIZE : 0;
+        events.clear();
+        for (u64 i = tail; i < head; i++) {
+            const auto& slot = buffer->slots[i & (ZONE_BUFFER_SIZE - 1)];
+            const u64 expected = i * 2 + 2;
+            if (slot.seq.load(std::memory_order_acquire) != expected) {
+                continue;
+            }
+            const Zone_event event {
+                slot.name.load(std::memory_order_relaxed),
+                slot.begin.load(std::memory_order_relaxed),
+                slot.end.load(std::memory_order_relaxed),
+            };
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == expected) {
+                events.push_back(event);
+            }
+        }
+        for (const auto& event : events) {
+            const double begin = to_us(event.begin);
+            fmt::print(file,
+                "{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                separator(), event.name, buffer->thread_id, begin, to_us(event.end) - begin);
+        }
+    }
+    fmt::print(file, "\n]}}\n");
+    LOG("Exported profiler trace to {}", filename);
+    return true;
+}
+
+#endif // RGL_PROFILE
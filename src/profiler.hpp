@@ -0,0 +1,105 @@
+#ifndef RGL_PROFILER_HPP
+#define RGL_PROFILER_HPP
+
+#include "types_utils.hpp"
+
+// Scoped zone profiler.
+// PROFILE_ZONE("name") records the lifetime of the enclosing scope into a
+// per-thread ring buffer, profiler_export_chrome_trace() dumps every buffer
+// as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+// Without RGL_PROFILE every macro compiles out and export is a no-op.
+
+#ifdef RGL_PROFILE
+
+#include <atomic>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// must be a power of two, oldest zones get overwritten
+constexpr u32 ZONE_BUFFER_SIZE = 1 << 14;
+
+struct Zone_event {
+    const char* name;
+    u64 begin;
+    u64 end;
+};
+
+// A ring slot, read by the exporter while its thread may be rewriting it.
+// `seq` is 2 * index + 2 once zone `index` is complete and odd while a
+// write is in progress; a reader keeps a copy only if `seq` held the
+// expected value before and after copying.
+struct Zone_slot {
+    std::atomic<u64> seq = 0;
+    std::atomic<const char*> name = nullptr;
+    std::atomic<u64> begin = 0;
+    std::atomic<u64> end = 0;
+};
+
+struct Zone_buffer {
+    Arr<Zone_slot, ZONE_BUFFER_SIZE> slots;
+    // total number of zones ever written, the writer is the owning thread only
+    std::atomic<u64> head = 0;
+    u32 thread_id = 0;
+    const char* thread_name = nullptr;
+};
+
+Zone_buffer* profiler_register_thread();
+
+inline thread_local Zone_buffer* zone_buffer = nullptr;
+
+// raw timestamp, converted to nanoseconds only on export
+inline u64 profiler_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+inline void profiler_push(const char* name, u64 begin, u64 end) {
+    if (zone_buffer == nullptr) {
+        zone_buffer = profiler_register_thread();
+    }
+    const u64 idx = zone_buffer->head.load(std::memory_order_relaxed);
+    auto& slot = zone_buffer->slots[idx & (ZONE_BUFFER_SIZE - 1)];
+    slot.seq.store(idx * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.begin.store(begin, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.seq.store(idx * 2 + 2, std::memory_order_release);
+    zone_buffer->head.store(idx + 1, std::memory_order_release);
+}
+
+struct Profile_zone {
+    const char* name;
+    u64 begin;
+
+    explicit Profile_zone(const char* name): name(name), begin(profiler_ticks()) {}
+    ~Profile_zone() { profiler_push(name, begin, profiler_ticks()); }
+
+    Profile_zone(const Profile_zone&) = delete;
+    Profile_zone& operator=(const Profile_zone&) = delete;
+};
+
+// name has to outlive the profiler (string literal)
+void profiler_set_thread_name(const char* name);
+bool profiler_export_chrome_trace(const char* filename);
+
+#define PROFILE_ZONE_(LINE) zz_zone##LINE
+#define PROFILE_ZONE_NAME(LINE) PROFILE_ZONE_(LINE)
+#define PROFILE_ZONE(name) Profile_zone PROFILE_ZONE_NAME(__LINE__){name}
+#define PROFILE_THREAD(name) profiler_set_thread_name(name)
+
+#else
+
+inline bool profiler_export_chrome_trace(const char*) { return false; }
+
+#define PROFILE_ZONE(name) ;
+#define PROFILE_THREAD(name) ;
+
+#endif // RGL_PROFILE
+
+#endif // RGL_PROFILER_HPP
@@ -1,5 +1,6 @@
 #include "renderable.hpp"
 #include <SDL2/SDL_render.h>
+#include <algorithm>
 
 void Renderable::add_sprite(SDL_Renderer *renderer, const char* filename) {
     auto tex = SDL_LoadBMP(filename);
@@ -11,3 +12,138 @@ Renderable::~Renderable() {
         SDL_DestroyTexture(texture);
     }
 }
+
+static void draw_map_tiles(SDL_Renderer* rndr, const Map& map, Vec2u min, Vec2u max,
+        SDL_Texture* wall_tex, SDL_Texture* bg_tex, u32 screen_w, u32 screen_h) {
+    float cell_width = screen_w / (float)map.width;
+    float cell_height = screen_h / (float)map.height;
+
+    SDL_Rect dst_rect = {0, 0, (int)(cell_width), (int)cell_height};
+
+    for (size_t y = min.y; y < max.y; ++y) {
+        for (size_t x = min.x; x < max.x; ++x) {
+            dst_rect.x = x * cell_width;
+            dst_rect.y = y * cell_height;
+
+            // Draw wall or empty space based on the map
+            SDL_Texture* texture;
+            auto tile = map.at(Vec2u{x, y});
+            if (tile == Tile::Wall) {
+                texture = wall_tex;
+            } else {
+                texture = bg_tex;
+            }
+            SDL_RenderCopy(rndr, texture, nullptr, &dst_rect);
+        }
+    }
+}
+
+void bake_map_texture(SDL_Renderer* rndr, SDL_Texture* target, const Map& map, 
+        SDL_Texture* wall_tex, SDL_Texture* bg_tex, u32 screen_w, u32 screen_h) {
+    SDL_SetRenderTarget(rndr, target);
+    SDL_RenderClear(rndr);
+    draw_map_tiles(rndr, map, Vec2u{0, 0}, Vec2u{map.width, map.height}, 
+            wall_tex, bg_tex, screen_w, screen_h);
+    SDL_SetRenderTarget(rndr, nullptr);
+}
+
+void bake_map_chunk(SDL_Renderer* rndr, SDL_Texture* target, const Map& map, Vec2u chunk,
+        SDL_Texture* wall_tex, SDL_Texture* bg_tex, u32 screen_w, u32 screen_h) {
+    const Vec2u min = {chunk.x * Map::CHUNK_SIZE, chunk.y * Map::CHUNK_SIZE};
+    const Vec2u max = {
+        std::min<u16>(min.x + Map::CHUNK_SIZE, map.width),
+        std::min<u16>(min.y + Map::CHUNK_SIZE, map.height)
+    };
+    SDL_SetRenderTarget(rndr, target);
+    draw_map_tiles(rndr, map, min, max, wall_tex, bg_tex, screen_w, screen_h);
+    SDL_SetRenderTarget(rndr, nullptr);
+}
+
+// overlay alpha for tiles nobody sees, lit tiles get quantised into buckets
+// so the whole overlay is a handful of batched fill calls
+constexpr byte unseen_alpha = 230;
+constexpr byte darkest_seen_alpha = 180;
+constexpr u32 light_buckets = 8;
+
+void draw_lighting(SDL_Renderer* rndr, const Tile_bits& visible, const Vec<byte>& light,
+        u32 screen_w, u32 screen_h, std::pmr::memory_resource* scratch) {
+    if (visible.width == 0 || visible.height == 0) {
+        return;
+    }
+    // bucket per tile first so every rect list is sized exactly once
+    const u32 tiles = (u32)visible.width * visible.height;
+    Pmr_vec<byte> tile_buckets(tiles, 0, scratch);
+    Arr<u32, light_buckets + 1> counts = {};
+    for (u16 y = 0; y < visible.height; y++) {
+        for (u16 x = 0; x < visible.width; x++) {
+            u32 bucket = light_buckets;
+            if (visible.test(Vec2u{x, y})) {
+                const u32 level = light.empty() ? 255 : light[x + visible.width * y];
+                bucket = (255 - level) * light_buckets / 256;
+            }
+            tile_buckets[x + visible.width * y] = bucket;
+            counts[bucket]++;
+        }
+    }
+    Pmr_vec<Pmr_vec<SDL_Rect>> rects(light_buckets + 1, scratch);
+    for (u32 bucket = 1; bucket <= light_buckets; bucket++) {
+        rects[bucket].reserve(counts[bucket]);
+    }
+    const float cell_width = screen_w / (float)visible.width;
+    const float cell_height = screen_h / (float)visible.height;
+    for (u16 y = 0; y < visible.height; y++) {
+        for (u16 x = 0; x < visible.width; x++) {
+            const byte bucket = tile_buckets[x + visible.width * y];
+            if (bucket == 0) {
+                continue;
+            }
+            // same rounding as bake_map_texture
+            rects[bucket].push_back(SDL_Rect{(int)(x * cell_width), (int)(y * cell_height), 
+                (int)cell_width, (int)cell_height});
+        }
+    }
+    SDL_SetRenderDrawBlendMode(rndr, SDL_BLENDMODE_BLEND);
+    for (u32 bucket = 1; bucket <= light_buckets; bucket++) {
+        if (rects[bucket].empty()) {
+            continue;
+        }
+        const byte alpha = bucket == light_buckets 
+            ? unseen_alpha : darkest_seen_alpha * bucket / (light_buckets - 1);
+        SDL_SetRenderDrawColor(rndr, 0, 0, 0, alpha);
+        SDL_RenderFillRects(rndr, rects[bucket].data(), rects[bucket].size());
+    }
+    SDL_SetRenderDrawBlendMode(rndr, SDL_BLENDMODE_NONE);
+}
+
+void draw_particles(SDL_Renderer* rndr, Particle_system& particles, u32 screen_w, u32 screen_h) {
+    if (particles.size() == 0) {
+        return;
+    }
+    particles.build_geometry(screen_w, screen_h);
+    SDL_SetRenderDrawBlendMode(rndr, SDL_BLENDMODE_BLEND);
+    SDL_RenderGeometryRaw(rndr, nullptr,
+            particles.vertex_xy.data(), 2 * sizeof(float),
+            particles.vertex_colors.data(), sizeof(SDL_Color),
+            nullptr, 0, particles.size() * 4,
+            particles.indices.data(), particles.size() * 6, sizeof(int));
+    SDL_SetRenderDrawBlendMode(rndr, SDL_BLENDMODE_NONE);
+}
+
+void draw_renderable(SDL_Renderer* rndr, const Renderable& elem, const Sprite_instance& inst, 
+        u32 screen_w, u32 screen_h) {
+    const auto count_frames = elem.sprites.size();
+    if (count_frames == 0) {
+        return;
+    }
+    SDL_SetRenderDrawColor(rndr, 0, 0, 0, 255);
+    SDL_Rect rect = {
+        (int)(inst.pos.x / Position::MAX * screen_w),
+        (int)(screen_h - (inst.pos.y / Position::MAX * screen_h) - elem.bnd.y), 
+        elem.bnd.x, 
+        elem.bnd.y
+    };
+    SDL_RendererFlip mirror_flip = 
+        inst.dir == Direction::left ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE;
+    SDL_RenderCopyEx(rndr, elem.sprites[inst.frame % count_frames], 
+            nullptr, &rect, 0.0, nullptr, mirror_flip); 
+}
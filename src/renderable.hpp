@@ -2,18 +2,58 @@
 #define RGL_RENDERBL_HPP
 
 #include "physics.hpp"
+#include "map.hpp"
+#include "entity.hpp"
+#include "fov.hpp"
 #include "types_utils.hpp"
+#include "alloc.hpp"
+#include "particles.hpp"
 #include <SDL2/SDL_render.h>
 #include <vector>
 
 struct Renderable {
-    Vec2i pos;
     Vec2i bnd;
-    Direction dir;
     std::vector<SDL_Texture*> sprites;
 
     void add_sprite(SDL_Renderer *renderer, const char* filename);
     ~Renderable();
 };
 
+// draws every map tile into target, a SDL_TEXTUREACCESS_TARGET texture
+void bake_map_texture(SDL_Renderer* rndr, SDL_Texture* target, const Map& map, 
+        SDL_Texture* wall_tex, SDL_Texture* bg_tex, u32 screen_w, u32 screen_h);
+
+// redraws the tiles of one Map::CHUNK_SIZE chunk into an already baked target
+void bake_map_chunk(SDL_Renderer* rndr, SDL_Texture* target, const Map& map, Vec2u chunk,
+        SDL_Texture* wall_tex, SDL_Texture* bg_tex, u32 screen_w, u32 screen_h);
+
+// per-entity draw state, copied out of the simulation every tick
+struct Sprite_instance {
+    ID          id;
+    Position    pos;
+    Direction   dir;
+    u32         frame;
+};
+
+// immutable view of the world handed from the simulation to the renderer
+struct Render_snapshot {
+    u64 tick = 0;
+    Vec<Sprite_instance> sprites;
+    // what the player sees and how lit it is, per map tile
+    Tile_bits visible;
+    Vec<byte> light;
+};
+
+// darkens tiles outside the visible mask and dims the rest by light level,
+// per call buffers come from `scratch`
+void draw_lighting(SDL_Renderer* rndr, const Tile_bits& visible, const Vec<byte>& light,
+        u32 screen_w, u32 screen_h,
+        std::pmr::memory_resource* scratch = std::pmr::get_default_resource());
+
+// every live particle in one geometry submission
+void draw_particles(SDL_Renderer* rndr, Particle_system& particles, u32 screen_w, u32 screen_h);
+
+void draw_renderable(SDL_Renderer* rndr, const Renderable& elem, const Sprite_instance& inst, 
+        u32 screen_w, u32 screen_h);
+
 #endif // RGL_RENDERBL_HPP
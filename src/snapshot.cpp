@@ -0,0 +1,225 @@
+#include "snapshot.hpp"
+#include "compress.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+constexpr size_t SECTION_ALIGN = 16;
+
+static size_t align_up(size_t size) {
+    return (size + SECTION_ALIGN - 1) & ~(SECTION_ALIGN - 1);
+}
+
+template <typename T>
+static void put_section(Vec<byte>& out, Snapshot_header& header, Snapshot_section section,
+        const T* items, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const size_t offset = align_up(out.size());
+    const size_t bytes = count * sizeof(T);
+    out.resize(offset + bytes);
+    if (bytes > 0) {
+        memcpy(out.data() + offset, items, bytes);
+    }
+    header.sections[section] = {
+        .offset = offset,
+        .count = count,
+        .elem_size = sizeof(T),
+        .padding = 0,
+    };
+}
+
+void write_snapshot(const Snapshot_source& src, Vec<byte>& out) {
+    PROFILE_ZONE("write_snapshot");
+    Snapshot_header header {
+        .magic = SNAPSHOT_MAGIC,
+        .version = SNAPSHOT_VERSION,
+        .tick = src.tick,
+        .depth = (uint32_t)src.depth,
+        .width = (uint16_t)src.map.width,
+        .height = (uint16_t)src.map.height,
+        .sections = {},
+    };
+    // padding between sections stays zeroed so equal states give equal bytes
+    out.assign(sizeof(header), 0);
+    put_section(out, header, SNAP_ENTITIES, src.entities.data(), src.entities.size());
+    put_section(out, header, SNAP_PHYSICS_IDS, src.physics.ids.data(), src.physics.ids.size());
+    put_section(out, header, SNAP_PHYSICS, src.physics.dense.data(), src.physics.dense.size());
+    put_section(out, header, SNAP_ANIM_IDS, src.anims.ids.data(), src.anims.ids.size());
+    put_section(out, header, SNAP_ANIMS, src.anims.dense.data(), src.anims.dense.size());
+    put_section(out, header, SNAP_TILES, src.map.tiles.data(), src.map.tiles.size());
+    memcpy(out.data(), &header, sizeof(header));
+}
+
+template <typename T>
+static bool view_section(const byte* data, size_t size, const Snapshot_header& header,
+        Snapshot_section section, std::span<const T>& items) {
+    const auto& info = header.sections[section];
+    if (info.elem_size != sizeof(T) || info.offset % SECTION_ALIGN != 0
+            || info.offset > size || info.count > (size - info.offset) / sizeof(T)) {
+        return false;
+    }
+    items = {reinterpret_cast<const T*>(data + info.offset), (size_t)info.count};
+    return true;
+}
+
+bool Snapshot_view::open(const byte* data, size_t size) {
+    Snapshot_header header;
+    if (size < sizeof(header) || reinterpret_cast<uintptr_t>(data) % SECTION_ALIGN != 0) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION) {
+        return false;
+    }
+    tick = header.tick;
+    depth = header.depth;
+    dim = Vec2u{header.width, header.height};
+    return view_section(data, size, header, SNAP_ENTITIES, entities)
+        && view_section(data, size, header, SNAP_PHYSICS_IDS, physics_ids)
+        && view_section(data, size, header, SNAP_PHYSICS, physics)
+        && view_section(data, size, header, SNAP_ANIM_IDS, anim_ids)
+        && view_section(data, size, header, SNAP_ANIMS, anims)
+        && view_section(data, size, header, SNAP_TILES, tiles)
+        && physics_ids.size() == physics.size()
+        && anim_ids.size() == anims.size()
+        && tiles.size() == (size_t)dim.x * dim.y;
+}
+
+bool read_snapshot_file(const char* filename, Vec<byte>& out) {
+    PROFILE_ZONE("read_snapshot_file");
+    FILE* file = fopen(filename, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    defer {
+        fclose(file);
+    };
+    if (fseek(file, 0, SEEK_END) != 0) {
+        return false;
+    }
+    const long size = ftell(file);
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0) {
+        return false;
+    }
+    out.resize(size);
+    return fread(out.data(), 1, size, file) == (size_t)size;
+}
+
+Snapshot_writer::Snapshot_writer() {
+    worker = std::thread(&Snapshot_writer::worker_loop, this);
+}
+
+Snapshot_writer::~Snapshot_writer() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    ready.notify_one();
+    worker.join();
+}
+
+void Snapshot_writer::save(const char* name, Vec<byte>& snapshot) {
+    {
+        std::lock_guard lock(mutex);
+        filename = name;
+        pending.swap(snapshot);
+        has_pending = true;
+    }
+    ready.notify_one();
+}
+
+void Snapshot_writer::worker_loop() {
+    PROFILE_THREAD("snapshot_writer");
+    Vec<byte> bytes;
+    std::string name;
+    std::unique_lock lock(mutex);
+    while (true) {
+        ready.wait(lock, [&] { return stopping || has_pending; });
+        // a pending save is still written when stopping
+        if (!has_pending) {
+            return;
+        }
+        bytes.swap(pending);
+        name = filename;
+        has_pending = false;
+        lock.unlock();
+        {
+            PROFILE_ZONE("write_snapshot_file");
+            // written aside and renamed so a crash never leaves half a save
+            const std::string tmp_name = name + ".tmp";
+            FILE* file = fopen(tmp_name.c_str(), "wb");
+            const bool written = file != nullptr
+                && fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+            if (file != nullptr && fclose(file) != 0) {
+                LOG_ERR("Failed to close {}", tmp_name.c_str());
+            } else if (!written || rename(tmp_name.c_str(), name.c_str()) != 0) {
+                LOG_ERR("Failed to save {}", name.c_str());
+            } else {
+                LOG("Saved {} ({} bytes)", name.c_str(), bytes.size());
+            }
+        }
+        lock.lock();
+    }
+}
+
+Rewind_buffer::Rewind_buffer(size_t budget): memory_budget(budget) {}
+
+void Rewind_buffer::xor_into_scratch(const Vec<byte>& lhs, const Vec<byte>& rhs) {
+    scratch.assign(std::max(lhs.size(), rhs.size()), 0);
+    for (size_t i = 0; i < lhs.size(); i++) {
+        scratch[i] = lhs[i];
+    }
+    for (size_t i = 0; i < rhs.size(); i++) {
+        scratch[i] ^= rhs[i];
+    }
+}
+
+void Rewind_buffer::push(const Vec<byte>& snapshot) {
+    PROFILE_ZONE("rewind_push");
+    if (!current.empty()) {
+        xor_into_scratch(current, snapshot);
+        Delta delta {
+            .packed = lz_compress(scratch.data(), scratch.size()),
+            .prev_size = (uint32_t)current.size(),
+        };
+        // most deltas are tiny, don't keep the compressor's headroom around
+        delta.packed.shrink_to_fit();
+        total_bytes += delta.packed.capacity() + sizeof(Delta);
+        deltas.push_back(std::move(delta));
+    }
+    current = snapshot;
+    while (!deltas.empty() && bytes() > memory_budget) {
+        total_bytes -= deltas.front().packed.capacity() + sizeof(Delta);
+        deltas.pop_front();
+    }
+}
+
+bool Rewind_buffer::step_back() {
+    PROFILE_ZONE("rewind_step");
+    if (deltas.empty()) {
+        return false;
+    }
+    const auto& delta = deltas.back();
+    if (!lz_decompress(delta.packed.data(), delta.packed.size(), scratch)
+            || scratch.size() < current.size() || scratch.size() < delta.prev_size) {
+        LOG_ERR("Corrupt rewind delta, dropping the rewind history");
+        clear();
+        return false;
+    }
+    current.resize(scratch.size(), 0);
+    for (size_t i = 0; i < scratch.size(); i++) {
+        current[i] ^= scratch[i];
+    }
+    current.resize(delta.prev_size);
+    total_bytes -= delta.packed.capacity() + sizeof(Delta);
+    deltas.pop_back();
+    return true;
+}
+
+void Rewind_buffer::clear() {
+    deltas.clear();
+    total_bytes = 0;
+    current.clear();
+}
@@ -0,0 +1,136 @@
+#ifndef RGL_SNAPSHOT_HPP
+#define RGL_SNAPSHOT_HPP
+
+#include "types_utils.hpp"
+#include "entity.hpp"
+#include "map.hpp"
+#include "physics.hpp"
+#include "animation.hpp"
+#include "component_pool.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+
+// Binary game state: a fixed header followed by the raw entity, component
+// and tile arrays, each 16 byte aligned. Saving is a memcpy per array and
+// a loaded buffer is read in place through Snapshot_view. The layout is
+// tied to the build, element sizes are checked on load.
+enum Snapshot_section : byte {
+    SNAP_ENTITIES,
+    SNAP_PHYSICS_IDS,
+    SNAP_PHYSICS,
+    SNAP_ANIM_IDS,
+    SNAP_ANIMS,
+    SNAP_TILES,
+    SNAP_SECTION_MAX,
+};
+
+constexpr Arr<char, 4> SNAPSHOT_MAGIC = {'R', 'G', 'L', 'S'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+struct Snapshot_header {
+    struct Section {
+        uint64_t offset;
+        uint64_t count;
+        uint32_t elem_size;
+        uint32_t padding;
+    };
+
+    Arr<char, 4> magic;
+    uint32_t version;
+    uint64_t tick;
+    uint32_t depth;
+    uint16_t width;
+    uint16_t height;
+    Arr<Section, SNAP_SECTION_MAX> sections;
+};
+
+// what goes into a snapshot, all borrowed
+struct Snapshot_source {
+    u64 tick;
+    u32 depth;
+    const Map& map;
+    const Vec<Entity>& entities;
+    const Component_pool<Physics>& physics;
+    const Component_pool<Animation>& anims;
+};
+
+// `out` is reused, it only grows
+void write_snapshot(const Snapshot_source& src, Vec<byte>& out);
+
+// Arrays of a snapshot read in place, valid while the bytes are.
+struct Snapshot_view {
+    u64   tick = 0;
+    u32   depth = 0;
+    Vec2u dim = {0, 0};
+    std::span<const Entity>    entities;
+    std::span<const ID>        physics_ids;
+    std::span<const Physics>   physics;
+    std::span<const ID>        anim_ids;
+    std::span<const Animation> anims;
+    std::span<const Tile>      tiles;
+
+    // false if the bytes aren't a snapshot from this build, `data` must be
+    // 16 byte aligned
+    bool open(const byte* data, size_t size);
+};
+
+bool read_snapshot_file(const char* filename, Vec<byte>& out);
+
+// Writes snapshots to disk on its own thread so saving never stalls the
+// caller. Only the newest pending snapshot is kept.
+struct Snapshot_writer {
+    Snapshot_writer();
+    ~Snapshot_writer();
+
+    // takes the bytes, leaving `snapshot` with a spare buffer
+    void save(const char* filename, Vec<byte>& snapshot);
+
+private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::string filename;
+    Vec<byte> pending;
+    bool has_pending = false;
+    bool stopping = false;
+    std::thread worker;
+
+    void worker_loop();
+};
+
+// Snapshots of the last ticks for rewinding. Only the newest one is kept
+// whole, every older one is the LZ compressed XOR against its successor,
+// which is mostly zeroes since little changes per tick. The oldest deltas
+// are dropped to stay within the budget.
+struct Rewind_buffer {
+    explicit Rewind_buffer(size_t memory_budget);
+
+    void push(const Vec<byte>& snapshot);
+    // turns latest() into the snapshot before it, false if there's none
+    bool step_back();
+    void clear();
+
+    const Vec<byte>& latest() const { return current; }
+    size_t steps() const { return deltas.size(); }
+    size_t bytes() const { return total_bytes + current.capacity(); }
+
+private:
+    struct Delta {
+        Vec<byte> packed;
+        // size of the older snapshot, the XOR covers the longer of both
+        uint32_t  prev_size;
+    };
+
+    const size_t memory_budget;
+    std::deque<Delta> deltas;
+    size_t total_bytes = 0;
+    Vec<byte> current;
+    Vec<byte> scratch;
+
+    void xor_into_scratch(const Vec<byte>& lhs, const Vec<byte>& rhs);
+};
+
+#endif // RGL_SNAPSHOT_HPP
@@ -0,0 +1,79 @@
+#ifndef RGL_SYNC_HPP
+#define RGL_SYNC_HPP
+
+#include "types_utils.hpp"
+#include <atomic>
+
+// Single writer / single reader triple buffer.
+// The writer fills write_buffer() and publishes it, the reader calls
+// update() and reads read_buffer(). Neither side ever waits, the reader
+// always gets the newest published value and skips the ones in between.
+template <typename T>
+struct Triple_buffer {
+    static constexpr byte INDEX_MASK = 0b011;
+    static constexpr byte FRESH_BIT  = 0b100;
+
+    Arr<T, 3> buffers;
+    // index of the buffer in the middle, FRESH_BIT set while it's unread
+    std::atomic<byte> middle = 1;
+    // owned by the writer
+    byte back = 0;
+    // owned by the reader
+    byte front = 2;
+
+    T& write_buffer() {
+        return buffers[back];
+    }
+
+    void publish() {
+        const byte prev = middle.exchange(back | FRESH_BIT, std::memory_order_acq_rel);
+        back = prev & INDEX_MASK;
+    }
+
+    // returns true if a newer value was picked up
+    bool update() {
+        if ((middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) {
+            return false;
+        }
+        const byte prev = middle.exchange(front, std::memory_order_acq_rel);
+        front = prev & INDEX_MASK;
+        return true;
+    }
+
+    const T& read_buffer() const {
+        return buffers[front];
+    }
+};
+
+// Bounded single producer / single consumer queue, wait-free on both ends.
+// n must be a power of two, push fails when the queue is full.
+template <typename T, size_t n>
+struct Spsc_queue {
+    static_assert((n & (n - 1)) == 0, "Spsc_queue size must be a power of two");
+
+    Arr<T, n> items;
+    alignas(64) std::atomic<size_t> head = 0; // next slot to read
+    alignas(64) std::atomic<size_t> tail = 0; // next slot to write
+
+    bool push(const T& item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == n) {
+            return false;
+        }
+        items[t & (n - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[h & (n - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif // RGL_SYNC_HPP
@@ -0,0 +1,21 @@
+#ifndef RGL_TESTS_CHECK_HPP
+#define RGL_TESTS_CHECK_HPP
+
+#include <cstdio>
+
+// Failed checks are printed and counted, a test's main() returns
+// check_result() so ctest sees the failure.
+inline int check_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        check_failures++; \
+    } \
+} while (0)
+
+inline int check_result() {
+    return check_failures == 0 ? 0 : 1;
+}
+
+#endif // RGL_TESTS_CHECK_HPP
@@ -0,0 +1,115 @@
+#include "check.hpp"
+#include "../flow_field.hpp"
+#include <random>
+
+// plain BFS from the field's current sources over its walkable tiles
+static Vec<uint16_t> reference(const Flow_field& field) {
+    Vec<uint16_t> dist(field.dist.size(), Flow_field::UNREACHABLE);
+    Vec<u32> queue;
+    for (const auto idx : field.sources) {
+        if (field.walkable[idx]) {
+            dist[idx] = 0;
+            queue.push_back(idx);
+        }
+    }
+    for (size_t head = 0; head < queue.size(); head++) {
+        const u32 idx = queue[head];
+        const u32 x = idx % field.width;
+        const u32 y = idx / field.width;
+        auto visit = [&](u32 n) {
+            if (field.walkable[n] && dist[n] == Flow_field::UNREACHABLE) {
+                dist[n] = dist[idx] + 1;
+                queue.push_back(n);
+            }
+        };
+        if (y > 0)                  visit(idx - field.width);
+        if (y + 1 < field.height)   visit(idx + field.width);
+        if (x > 0)                  visit(idx - 1);
+        if (x + 1 < field.width)    visit(idx + 1);
+    }
+    return dist;
+}
+
+static Vec2u tile_of(const Flow_field& field, u32 idx) {
+    return Vec2u{(u16)(idx % field.width), (u16)(idx / field.width)};
+}
+
+// a target walking to adjacent tiles is a plain BFS a step, it never
+// invalidates half the field first and then falls back to one
+static void adjacent_moves(const Map& map) {
+    Flow_field field(map);
+    Vec<u32> walkable;
+    for (u32 i = 0; i < field.walkable.size(); i++) {
+        if (field.walkable[i]) {
+            walkable.push_back(i);
+        }
+    }
+    CHECK(!walkable.empty());
+    std::minstd_rand rng(7);
+    u32 target = walkable[rng() % walkable.size()];
+    field.set_target(tile_of(field, target));
+    const u64 start = field.fallback_count;
+    u32 moves = 0;
+    for (u32 step = 0; step < 500; step++) {
+        Vec<u32> next;
+        const u32 x = target % field.width;
+        const u32 y = target / field.width;
+        for (const auto n : {y > 0 ? target - field.width : target,
+                             y + 1 < field.height ? target + field.width : target,
+                             x > 0 ? target - 1 : target,
+                             x + 1 < field.width ? target + 1 : target}) {
+            if (n != target && field.walkable[n]) {
+                next.push_back(n);
+            }
+        }
+        if (next.empty()) {
+            break;
+        }
+        target = next[rng() % next.size()];
+        field.set_target(tile_of(field, target));
+        moves++;
+        CHECK(field.dist == reference(field));
+    }
+    CHECK(moves > 0);
+    CHECK(field.fallback_count == start);
+}
+
+// added sources and tile edits are repaired in place
+static void incremental_updates(const Map& map) {
+    Flow_field field(map);
+    Vec<u32> walkable;
+    for (u32 i = 0; i < field.walkable.size(); i++) {
+        if (field.walkable[i]) {
+            walkable.push_back(i);
+        }
+    }
+    std::minstd_rand rng(11);
+    Vec<Vec2u> sources = {tile_of(field, walkable[rng() % walkable.size()])};
+    field.set_sources(sources);
+    const u64 start = field.fallback_count;
+    for (u32 i = 0; i < 4; i++) {
+        sources.push_back(tile_of(field, walkable[rng() % walkable.size()]));
+        field.set_sources(sources);
+        CHECK(field.dist == reference(field));
+    }
+    CHECK(field.fallback_count == start);
+
+    Map edited(Vec2u{map.width, map.height}, map.tiles);
+    const u32 edits = 200;
+    for (u32 i = 0; i < edits; i++) {
+        const Vec2u tile = tile_of(field, rng() % edited.tiles.size());
+        edited.set(tile, edited.at(tile) == Tile::Empty ? Tile::Wall : Tile::Empty);
+        field.on_tile_changed(edited, tile);
+        CHECK(field.dist == reference(field));
+    }
+    CHECK(field.fallback_count - start < edits / 10);
+}
+
+int main() {
+    for (const auto size : {Vec2u{32, 24}, Vec2u{64, 48}}) {
+        const Map map(size, Vec2u{(u16)(size.x / 2), (u16)(size.y / 2)}, false, 1);
+        adjacent_moves(map);
+        incremental_updates(map);
+    }
+    return check_result();
+}
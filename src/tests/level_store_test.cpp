@@ -0,0 +1,65 @@
+#include "check.hpp"
+#include "../level_store.hpp"
+#include <chrono>
+#include <thread>
+
+// small open levels, all the same size
+static Uq_ptr<Level> make_level(u32) {
+    auto level = std::make_unique<Level>();
+    level->map = std::make_unique<Map>(Vec2u{8, 8}, Vec<Tile>(64, Tile::Empty));
+    return level;
+}
+
+// waits for the worker to settle, busy levels count as neither
+static Level_store_stats settled(const Level_store& store, u32 levels) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    auto stats = store.stats();
+    while (stats.resident_levels + stats.packed_levels < levels
+            && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stats = store.stats();
+    }
+    return stats;
+}
+
+// Pinned levels (the active one and its neighbours) don't count against
+// the budget, so a budget of one and a half levels keeps the most recent
+// unpinned level resident and packs the one before it.
+static void unpinned_level_stays_resident() {
+    const size_t level_bytes = make_level(0)->resident_bytes();
+    Level_store store(level_bytes * 3 / 2, make_level);
+    for (u32 depth = 0; depth <= 3; depth++) {
+        store.enter(depth);
+    }
+    // 0 and 1 unpinned, 2 to 4 pinned around 3
+    const auto stats = settled(store, 5);
+    CHECK(stats.resident_levels == 4);
+    CHECK(stats.packed_levels == 1);
+}
+
+// a level that takes long to generate, standing in for a slow prefetch
+static Uq_ptr<Level> make_slow_level(u32 depth) {
+    if (depth == 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    }
+    return make_level(depth);
+}
+
+// entering a level that isn't ready doesn't queue behind the prefetch the
+// worker is busy with
+static void enter_skips_running_prefetch() {
+    Level_store store(0, make_slow_level);
+    store.enter(0);
+    // let the worker start on depth 1
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    store.enter(5);
+    const auto stats = store.stats();
+    CHECK(!stats.last_switch_hit);
+    CHECK(stats.last_switch_ms < 150.0);
+}
+
+int main() {
+    unpinned_level_stays_resident();
+    enter_skips_running_prefetch();
+    return check_result();
+}
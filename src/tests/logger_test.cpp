@@ -0,0 +1,29 @@
+#include "check.hpp"
+#include "../logger.hpp"
+#include <fmt/ranges.h>
+#include <span>
+#include <vector>
+
+struct Has_pointer {
+    const int* value;
+};
+
+enum Some_enum : uint8_t { SOME_VALUE };
+
+int main() {
+    // only plain values wait for the background thread
+    CHECK(log_deferrable<int>);
+    CHECK(log_deferrable<double>);
+    CHECK(log_deferrable<bool>);
+    CHECK(log_deferrable<Some_enum>);
+    CHECK(log_deferrable<Log_level>);
+    // anything that may point at the caller's data is formatted eagerly
+    CHECK(!log_deferrable<const char*>);
+    CHECK(!log_deferrable<std::string_view>);
+    CHECK(!log_deferrable<fmt::string_view>);
+    CHECK(!log_deferrable<std::span<const int>>);
+    CHECK(!log_deferrable<Has_pointer>);
+    using Join = decltype(fmt::join(std::declval<std::vector<int>&>(), ", "));
+    CHECK(!log_deferrable<Join>);
+    return check_result();
+}
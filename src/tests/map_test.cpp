@@ -0,0 +1,36 @@
+#include "check.hpp"
+#include "../map.hpp"
+
+struct Expected_map {
+    Vec2u size;
+    u32 seed;
+    u32 empty;
+    u32 walls;
+};
+
+// Tile counts generated with 32-bit solver weights. Narrower weights wrap
+// while they pile up and the wall share drops (453 to 273 walls for the
+// first map), so any change here means the generator itself changed.
+constexpr Arr<Expected_map, 6> EXPECTED {{
+    {{32, 24}, 1, 315, 453},
+    {{32, 24}, 2, 329, 439},
+    {{32, 24}, 3, 310, 458},
+    {{64, 48}, 1, 1455, 1617},
+    {{64, 48}, 2, 1442, 1630},
+    {{64, 48}, 3, 1509, 1563},
+}};
+
+int main() {
+    for (const auto& expected : EXPECTED) {
+        const auto size = expected.size;
+        const Map map(size, Vec2u{(u16)(size.x / 2), (u16)(size.y / 2)}, false, expected.seed);
+        Arr<u32, TILE_MAX + 1> counts = {};
+        for (const auto tile : map.tiles) {
+            counts[tile]++;
+        }
+        CHECK(counts[Tile::Empty] == expected.empty);
+        CHECK(counts[Tile::Wall] == expected.walls);
+        CHECK(counts[Tile::Empty] + counts[Tile::Wall] == map.tiles.size());
+    }
+    return check_result();
+}
@@ -24,8 +24,6 @@ using Arr = std::array<T, n>;
 template <typename T>
 using Vec = std::vector<T>;
 
-#define DEBUG
-
 // defer
 #ifndef defer
 struct defer_dummy {};
@@ -36,17 +34,8 @@ template <class F> deferrer<F> operator*(defer_dummy, F f) { return {f}; }
 #define defer auto DEFER(__LINE__) = defer_dummy{} *[&]()
 #endif // defer
 
-#define LOG(...) \
-    fmt::print(stdout, "{}\n", fmt::format(__VA_ARGS__))
-#define LOG_ERR(...) \
-    fmt::print(stderr, "\033[1;31m{}\033[0m\n", fmt::format(__VA_ARGS__))
-
-#ifdef DEBUG 
-#define LOG_DBG(...) \
-    fmt::print(stderr, "\033[1;33m{}\033[0m\n", fmt::format(__VA_ARGS__))
-#else 
-#define LOG_DBG(...) ;
-#endif
+// LOG, LOG_ERR, LOG_DBG
+#include "logger.hpp"
 
 struct Vec2u {
     u16 x;